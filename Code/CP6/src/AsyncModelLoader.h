@@ -0,0 +1,192 @@
+#ifndef ASYNCMODELLOADER_H
+#define ASYNCMODELLOADER_H
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <glm/glm.hpp>
+#include "OBJLoader.h"
+#include "TextureStreamer.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+
+// 后台加载模型：OBJ（或网格缓存）与MTL在工作线程读取、解析，结果经完成队列交给渲染线程，
+// 渲染线程每帧调用update，取出结果后完成GL上传并把贴图交给TextureStreamer。
+// 加载期间窗口保持响应，解析出包围盒后即可显示代理
+class AsyncModelLoader {
+public:
+    // 模型网格上传完成、材质准备好后为true，此后可以按materials与fallbackMaterial绘制model
+    bool ready = false;
+    // 网格加载失败后为true，error为错误信息；此后不再有包围盒（hasBounds为false），模型不会就绪
+    bool failed = false;
+    std::string error;
+    // 当前加载阶段与包围盒（hasBounds为true后有效）
+    OBJLoader::LoadStage stage = OBJLoader::LOAD_PARSING;
+    bool hasBounds = false;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    // MTL中的材质（贴图由TextureStreamer流式上传）；OBJ中未指定或MTL中找不到的材质使用fallbackMaterial
+    std::map<std::string, Utils::PBRMaterial> materials;
+    Utils::PBRMaterial fallbackMaterial = Utils::createDefaultPBRMaterial();
+
+    // model与streamer需比本对象存活更久；model的加载选项需在start之前设置
+    AsyncModelLoader(OBJLoader& model, TextureStreamer& streamer)
+        : model(model), streamer(streamer), events(std::make_shared<CompletionQueue<Event>>()) {}
+
+    // 等待仍在运行的加载任务结束，任务中会写入model
+    ~AsyncModelLoader() {
+        while (running > 0) {
+            if (events->pop().finished) {
+                running--;
+            }
+        }
+        model.onProgress = nullptr;
+    }
+
+    AsyncModelLoader(const AsyncModelLoader&) = delete;
+    AsyncModelLoader& operator=(const AsyncModelLoader&) = delete;
+
+    void start(const Utils::ModelFiles& files) {
+        std::shared_ptr<CompletionQueue<Event>> queue = events;
+        OBJLoader* target = &model;
+        target->onProgress = [queue, target](OBJLoader::LoadStage stage) {
+            Event event;
+            event.kind = EVENT_STAGE;
+            event.stage = stage;
+            if (stage >= OBJLoader::LOAD_WELDING) {
+                event.boundsMin = target->boundsMin;
+                event.boundsMax = target->boundsMax;
+            }
+            queue->push(std::move(event));
+        };
+        std::string objPath = files.objPath;
+        running++;
+        ThreadPool::shared().submit([queue, target, objPath]() {
+            Event event;
+            event.kind = target->prepare(objPath) ? EVENT_MESH : EVENT_FAILED;
+            event.finished = true;
+            event.message = objPath;
+            queue->push(std::move(event));
+        });
+
+        if (files.mtlPath.empty()) {
+            materialsReady = true;
+            return;
+        }
+        std::string mtlPath = files.mtlPath, directory = files.directory;
+        running++;
+        ThreadPool::shared().submit([queue, mtlPath, directory]() {
+            Event event;
+            event.kind = EVENT_MATERIALS;
+            event.finished = true;
+            event.materials = Utils::parseMTL(mtlPath, directory);
+            queue->push(std::move(event));
+        });
+    }
+
+    // 每帧在GL线程调用；网格与材质都就绪的那一帧返回true
+    bool update() {
+        Event event;
+        while (events->tryPop(event)) {
+            if (event.finished) {
+                running--;
+            }
+            switch (event.kind) {
+            case EVENT_STAGE:
+                if (failed) {
+                    break;
+                }
+                stage = event.stage;
+                if (stage >= OBJLoader::LOAD_WELDING && !hasBounds) {
+                    hasBounds = true;
+                    boundsMin = event.boundsMin;
+                    boundsMax = event.boundsMax;
+                }
+                break;
+            case EVENT_MESH:
+                // prepare已结束，此后渲染线程可以读取model的字段
+                model.upload();
+                stage = OBJLoader::LOAD_READY;
+                hasBounds = true;
+                boundsMin = model.boundsMin;
+                boundsMax = model.boundsMax;
+                meshReady = true;
+                break;
+            case EVENT_MATERIALS:
+                beginTextures(std::move(event.materials));
+                break;
+            case EVENT_FAILED:
+                error = "Failed to load car model: " + event.message;
+                std::cerr << error << std::endl;
+                failed = true;
+                hasBounds = false;
+                break;
+            }
+        }
+        if (!ready && meshReady && materialsReady) {
+            ready = true;
+            return true;
+        }
+        return false;
+    }
+
+    // 网格加载进度（0到1）
+    float progress() const {
+        if (failed) {
+            return 0.0f;
+        }
+        if (meshReady) {
+            return 1.0f;
+        }
+        return static_cast<float>(stage) / OBJLoader::LOAD_STAGE_COUNT;
+    }
+
+    const char* stageName() const {
+        if (failed) {
+            return "Failed";
+        }
+        if (meshReady) {
+            return "Uploaded";
+        }
+        static const char* names[OBJLoader::LOAD_STAGE_COUNT] = {"Parsing OBJ",       "Welding vertices",
+                                                                 "Computing tangents", "Optimizing layout",
+                                                                 "Writing cache",      "Uploading"};
+        return names[stage];
+    }
+
+private:
+    enum EventKind { EVENT_STAGE, EVENT_MESH, EVENT_MATERIALS, EVENT_FAILED };
+
+    struct Event {
+        EventKind kind = EVENT_STAGE;
+        // 任务的最后一个事件
+        bool finished = false;
+        OBJLoader::LoadStage stage = OBJLoader::LOAD_PARSING;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+        std::map<std::string, Utils::PBRMaterial> materials;
+        std::string message;
+    };
+
+    OBJLoader& model;
+    TextureStreamer& streamer;
+    std::shared_ptr<CompletionQueue<Event>> events;
+    int running = 0;
+    bool meshReady = false;
+    bool materialsReady = false;
+
+    void beginTextures(std::map<std::string, Utils::PBRMaterial> parsed) {
+        materials = std::move(parsed);
+        std::map<std::string, unsigned int> textures = streamer.request(Utils::texturePaths(materials));
+        Utils::assignTextures(materials, textures);
+        std::cout << "MTL文件加载成功: " << materials.size() << " 个材质, " << textures.size() << " 张贴图" << std::endl;
+        if (!materials.empty()) {
+            fallbackMaterial = materials.begin()->second;
+            std::cout << "Fallback material: " << materials.begin()->first << std::endl;
+        }
+        materialsReady = true;
+    }
+};
+
+#endif
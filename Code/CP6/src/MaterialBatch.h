@@ -0,0 +1,134 @@
+#ifndef MATERIALBATCH_H
+#define MATERIALBATCH_H
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <glad/glad.h>
+#include "OBJLoader.h"
+#include "Utils.h"
+
+// 按材质分段绘制模型：每个子网格一次绘制，共用模型的VAO/VBO/EBO。
+// 绘制顺序按纹理状态排序，每种贴图固定使用一个纹理单元，只在贴图或材质参数变化时才重新绑定、设置
+class MaterialBatch {
+public:
+    // 各贴图使用的纹理单元
+    enum TextureSlot { ALBEDO = 0, METALLIC, ROUGHNESS, NORMAL, AO, SLOT_COUNT };
+
+    // 上一次draw的统计
+    int drawCalls = 0;
+    int materialChanges = 0;
+    int textureBinds = 0;
+
+    // 为每个子网格查找材质并排序；MTL中找不到的材质使用fallback。
+    // 只保存指针，model重新加载或materials、fallback销毁后需重新build
+    void build(const OBJLoader& model, const std::map<std::string, Utils::PBRMaterial>& materials,
+               const Utils::PBRMaterial& fallback) {
+        draws.clear();
+        for (const SubMesh& subMesh : model.subMeshes) {
+            auto found = materials.find(subMesh.material);
+            if (found == materials.end()) {
+                std::cout << "Material not found, using fallback: " << subMesh.material << std::endl;
+            }
+            draws.push_back({&subMesh, found != materials.end() ? &found->second : &fallback});
+        }
+        // 相同贴图组合的子网格相邻，贴图相同时按材质分组
+        std::stable_sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) {
+            return std::make_tuple(a.material->albedoMap, a.material->normalMap, a.material->metallicMap,
+                                   a.material->roughnessMap, a.material->aoMap, a.material) <
+                   std::make_tuple(b.material->albedoMap, b.material->normalMap, b.material->metallicMap,
+                                   b.material->roughnessMap, b.material->aoMap, b.material);
+        });
+    }
+
+    // 设置采样器对应的纹理单元，着色器程序创建后调用一次
+    static void bindSamplers(GLuint shaderProgram) {
+        glUseProgram(shaderProgram);
+        glUniform1i(glGetUniformLocation(shaderProgram, "albedoMap"), ALBEDO);
+        glUniform1i(glGetUniformLocation(shaderProgram, "metallicMap"), METALLIC);
+        glUniform1i(glGetUniformLocation(shaderProgram, "roughnessMap"), ROUGHNESS);
+        glUniform1i(glGetUniformLocation(shaderProgram, "normalMap"), NORMAL);
+        glUniform1i(glGetUniformLocation(shaderProgram, "aoMap"), AO);
+    }
+
+    // 绘制全部子网格；着色器程序需已在使用中，变换矩阵等逐帧uniform需已设置
+    void draw(GLuint shaderProgram, const OBJLoader& model) {
+        if (shaderProgram != program) {
+            program = shaderProgram;
+            locations = Locations(shaderProgram);
+        }
+        drawCalls = 0;
+        materialChanges = 0;
+        textureBinds = 0;
+        // 帧之间其他绘制可能改动了纹理绑定，每帧从未知状态开始
+        GLuint bound[SLOT_COUNT];
+        std::fill(bound, bound + SLOT_COUNT, ~0u);
+        const Utils::PBRMaterial* current = nullptr;
+
+        glBindVertexArray(model.VAO);
+        for (const Draw& draw : draws) {
+            if (draw.material != current) {
+                current = draw.material;
+                apply(*current, bound);
+                materialChanges++;
+            }
+            model.drawSubMesh(*draw.subMesh);
+            drawCalls++;
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    struct Draw {
+        const SubMesh* subMesh;
+        const Utils::PBRMaterial* material;
+    };
+
+    struct Locations {
+        GLint albedo = -1, metallic = -1, roughness = -1, ao = -1;
+        GLint useMap[SLOT_COUNT] = {-1, -1, -1, -1, -1};
+
+        Locations() = default;
+        explicit Locations(GLuint shaderProgram) {
+            albedo = glGetUniformLocation(shaderProgram, "albedo");
+            metallic = glGetUniformLocation(shaderProgram, "metallic");
+            roughness = glGetUniformLocation(shaderProgram, "roughness");
+            ao = glGetUniformLocation(shaderProgram, "ao");
+            useMap[ALBEDO] = glGetUniformLocation(shaderProgram, "useAlbedoMap");
+            useMap[METALLIC] = glGetUniformLocation(shaderProgram, "useMetallicMap");
+            useMap[ROUGHNESS] = glGetUniformLocation(shaderProgram, "useRoughnessMap");
+            useMap[NORMAL] = glGetUniformLocation(shaderProgram, "useNormalMap");
+            useMap[AO] = glGetUniformLocation(shaderProgram, "useAOMap");
+        }
+    };
+
+    std::vector<Draw> draws;
+    GLuint program = 0;
+    Locations locations;
+
+    void apply(const Utils::PBRMaterial& material, GLuint* bound) {
+        glUniform3f(locations.albedo, material.albedo.x, material.albedo.y, material.albedo.z);
+        glUniform1f(locations.metallic, material.metallic);
+        glUniform1f(locations.roughness, material.roughness);
+        glUniform1f(locations.ao, material.ao);
+
+        const unsigned int maps[SLOT_COUNT] = {material.albedoMap, material.metallicMap, material.roughnessMap,
+                                               material.normalMap, material.aoMap};
+        for (int slot = 0; slot < SLOT_COUNT; slot++) {
+            glUniform1i(locations.useMap[slot], maps[slot] != 0 ? 1 : 0);
+            // 没有贴图时着色器不会采样该单元，保留原绑定
+            if (maps[slot] != 0 && maps[slot] != bound[slot]) {
+                glActiveTexture(GL_TEXTURE0 + slot);
+                glBindTexture(GL_TEXTURE_2D, maps[slot]);
+                bound[slot] = maps[slot];
+                textureBinds++;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "MappedFile.h"
+
+// 网格二进制缓存：与OBJ同目录的<源文件>.meshcache，保存处理完成的顶点、索引、包围盒与材质范围。
+// 以源文件的大小和修改时间作为键，任一不符或版本、顶点格式变化时视为失效并重新生成。
+// 文件布局：Header，随后是按16字节对齐的顶点块、索引块（uint32）与Range表
+namespace MeshCache {
+
+constexpr uint32_t MAGIC = 0x48534D43u; // "CMSH"
+constexpr uint32_t VERSION = 3;
+
+// 生成网格时的选项，不同选项的缓存互不通用
+enum Flags : uint32_t {
+    FLAG_OPTIMIZED_LAYOUT = 1u << 0,
+    FLAG_COMPACT_VERTICES = 1u << 1,
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint32_t flags;
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t rangeCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    float acmrBefore;
+    float acmrAfter;
+    uint32_t reserved;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t rangeOffset;
+};
+
+// 使用同一材质的一段连续索引
+struct Range {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    char material[120];
+};
+
+// 源文件的键；文件不存在时valid为false
+struct SourceKey {
+    uint64_t size = 0;
+    int64_t time = 0;
+    bool valid = false;
+};
+
+inline std::string cachePath(const std::string& sourcePath) {
+    return sourcePath + ".meshcache";
+}
+
+inline SourceKey sourceKey(const std::string& sourcePath) {
+    SourceKey key;
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(sourcePath, error);
+    if (error) {
+        return key;
+    }
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(sourcePath, error);
+    if (error) {
+        return key;
+    }
+    key.size = static_cast<uint64_t>(size);
+    key.time = static_cast<int64_t>(time.time_since_epoch().count());
+    key.valid = true;
+    return key;
+}
+
+inline uint64_t alignUp(uint64_t offset) {
+    return (offset + 15) & ~uint64_t(15);
+}
+
+// 写入缓存：先写到临时文件再改名，写到一半退出不会留下损坏的缓存。header中的计数与偏移由此函数填写
+inline bool write(const std::string& path, Header header, const void* vertices, const uint32_t* indices,
+                  const std::vector<Range>& ranges) {
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.rangeCount = static_cast<uint32_t>(ranges.size());
+    header.vertexOffset = alignUp(sizeof(Header));
+    header.indexOffset = alignUp(header.vertexOffset + uint64_t(header.vertexCount) * header.vertexStride);
+    header.rangeOffset = alignUp(header.indexOffset + uint64_t(header.indexCount) * sizeof(uint32_t));
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        const char padding[16] = {};
+        auto writeAt = [&](uint64_t offset, const void* data, uint64_t bytes) {
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(padding, static_cast<std::streamsize>(offset - position));
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        };
+        writeAt(0, &header, sizeof(Header));
+        writeAt(header.vertexOffset, vertices, uint64_t(header.vertexCount) * header.vertexStride);
+        writeAt(header.indexOffset, indices, uint64_t(header.indexCount) * sizeof(uint32_t));
+        writeAt(header.rangeOffset, ranges.data(), ranges.size() * sizeof(Range));
+        if (!file) {
+            file.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 映射缓存文件并校验；校验通过后各数据块直接指向映射的页面
+class Reader {
+public:
+    bool open(const std::string& path, const SourceKey& key, uint32_t flags, uint32_t vertexStride) {
+        if (!key.valid || !file.open(path) || file.size() < sizeof(Header)) {
+            file.close();
+            return false;
+        }
+        std::memcpy(&head, file.data(), sizeof(Header));
+        uint64_t size = file.size();
+        bool valid = head.magic == MAGIC && head.version == VERSION && head.sourceSize == key.size &&
+                     head.sourceTime == key.time && head.flags == flags && head.vertexStride == vertexStride &&
+                     head.vertexOffset % 16 == 0 && head.indexOffset % 16 == 0 && head.rangeOffset % 16 == 0 &&
+                     head.vertexOffset + uint64_t(head.vertexCount) * head.vertexStride <= size &&
+                     head.indexOffset + uint64_t(head.indexCount) * sizeof(uint32_t) <= size &&
+                     head.rangeOffset + uint64_t(head.rangeCount) * sizeof(Range) <= size;
+        if (!valid) {
+            file.close();
+            return false;
+        }
+        // 索引不能越界，否则上传后绘制会读到缓冲区外
+        const uint32_t* index = indices();
+        for (uint32_t i = 0; i < head.indexCount; i++) {
+            if (index[i] >= head.vertexCount) {
+                file.close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const Header& header() const { return head; }
+    const void* vertices() const { return file.data() + head.vertexOffset; }
+    const uint32_t* indices() const { return reinterpret_cast<const uint32_t*>(file.data() + head.indexOffset); }
+    const Range* ranges() const { return reinterpret_cast<const Range*>(file.data() + head.rangeOffset); }
+
+private:
+    MappedFile file;
+    Header head = {};
+};
+
+} // namespace MeshCache
+
+#endif
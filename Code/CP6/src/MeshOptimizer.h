@@ -0,0 +1,215 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <glm/glm.hpp>
+
+// 索引三角形网格的离线重排：
+// 1. 三角形按Tipsify（Sander等，2007）重排，提高变换后顶点缓存的命中率；
+// 2. 以Tipsify中缓存失效的位置把三角形分成簇，按与视点无关的遮挡度量对簇排序，减少过度绘制；
+// 3. 顶点按首次被引用的顺序重排，提高顶点读取的局部性
+namespace MeshOptimizer {
+
+// 模拟的顶点缓存大小（FIFO）
+constexpr int CACHE_SIZE = 16;
+
+// 平均缓存未命中率ACMR：每个三角形平均需要变换的顶点数（理想值约0.5，最差为3）
+inline float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = CACHE_SIZE) {
+    if (indices.size() < 3) {
+        return 0.0f;
+    }
+    // 记录每个顶点进入缓存时的计数，与当前计数相差不超过cacheSize即仍在缓存中
+    std::vector<size_t> stamp(vertexCount, 0);
+    size_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (unsigned int index : indices) {
+        if (time - stamp[index] > static_cast<size_t>(cacheSize)) {
+            stamp[index] = time++;
+            misses++;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+// 按Tipsify重排三角形；clusters返回各簇第一个三角形的编号（升序，首项为0）
+inline void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                                std::vector<unsigned int>& clusters, int cacheSize = CACHE_SIZE) {
+    size_t triangleCount = indices.size() / 3;
+    clusters.clear();
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // 顶点到相邻三角形的邻接表（CSR），live为每个顶点尚未输出的三角形数
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (unsigned int index : indices) {
+        live[index]++;
+    }
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+    }
+
+    std::vector<size_t> stamp(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    deadEnd.reserve(indices.size());
+    size_t time = cacheSize + 1;
+    size_t scan = 0;
+
+    // 当前扇形的中心顶点
+    long long fanning = indices[0];
+    clusters.push_back(0);
+    while (fanning >= 0) {
+        candidates.clear();
+        for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = 1;
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[triangle * 3 + k];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - stamp[v] > static_cast<size_t>(cacheSize)) {
+                    stamp[v] = time++;
+                }
+            }
+        }
+
+        // 下一个中心：优先选仍在缓存中、且输出其剩余三角形后不会被挤出缓存的最早进入者
+        long long next = -1;
+        long long best = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            long long priority = 0;
+            long long age = static_cast<long long>(time - stamp[v]);
+            if (age + 2 * static_cast<long long>(live[v]) <= cacheSize) {
+                priority = age;
+            }
+            if (priority > best) {
+                best = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0) {
+            // 死胡同：先回溯最近输出过的顶点，再按顺序扫描；此处缓存的局部性中断，开始新簇
+            while (!deadEnd.empty() && next < 0) {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) {
+                    next = v;
+                }
+            }
+            while (next < 0 && scan < vertexCount) {
+                if (live[scan] > 0) {
+                    next = static_cast<long long>(scan);
+                }
+                scan++;
+            }
+            if (next >= 0 && result.size() / 3 > clusters.back()) {
+                clusters.push_back(static_cast<unsigned int>(result.size() / 3));
+            }
+        }
+        fanning = next;
+    }
+
+    indices.swap(result);
+}
+
+// 簇按与视点无关的遮挡度量排序：簇中心相对网格中心越朝向簇的平均法线方向（越靠外），
+// 越可能遮挡其他簇，越先绘制；簇内顺序不变，因此顶点缓存的命中率基本不受影响
+template <typename VertexT>
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<VertexT>& vertices,
+                      const std::vector<unsigned int>& clusters) {
+    size_t triangleCount = indices.size() / 3;
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    // 网格的面积加权中心
+    glm::dvec3 meshCenter(0.0);
+    double meshArea = 0.0;
+    std::vector<glm::dvec3> centroids(clusters.size(), glm::dvec3(0.0));
+    std::vector<glm::dvec3> normals(clusters.size(), glm::dvec3(0.0));
+    std::vector<double> areas(clusters.size(), 0.0);
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        for (size_t t = clusters[c]; t < end; t++) {
+            glm::dvec3 p0(vertices[indices[t * 3]].Position);
+            glm::dvec3 p1(vertices[indices[t * 3 + 1]].Position);
+            glm::dvec3 p2(vertices[indices[t * 3 + 2]].Position);
+            // 叉积的长度是面积的两倍，方向是法线
+            glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+            double area = glm::length(normal);
+            centroids[c] += (p0 + p1 + p2) * (area / 3.0);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCenter += centroids[c];
+        meshArea += areas[c];
+    }
+    if (meshArea > 0.0) {
+        meshCenter /= meshArea;
+    }
+
+    std::vector<double> sortKey(clusters.size(), 0.0);
+    for (size_t c = 0; c < clusters.size(); c++) {
+        double normalLength = glm::length(normals[c]);
+        if (areas[c] <= 0.0 || normalLength <= 0.0) {
+            continue;
+        }
+        glm::dvec3 centroid = centroids[c] / areas[c];
+        sortKey[c] = glm::dot(centroid - meshCenter, normals[c] / normalLength);
+    }
+
+    std::vector<unsigned int> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (unsigned int c : order) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + end * 3);
+    }
+    indices.swap(result);
+}
+
+// 顶点按在索引缓冲中首次出现的顺序重排，未被引用的顶点被丢弃
+template <typename VertexT>
+void optimizeVertexFetch(std::vector<VertexT>& vertices, std::vector<unsigned int>& indices) {
+    constexpr unsigned int UNUSED = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    std::vector<VertexT> result;
+    result.reserve(vertices.size());
+    for (unsigned int& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = static_cast<unsigned int>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(result);
+}
+
+} // namespace MeshOptimizer
+
+#endif
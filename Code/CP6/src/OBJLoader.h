@@ -1,118 +1,248 @@
 #ifndef OBJLOADER_H
 #define OBJLOADER_H
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glad/glad.h>
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "OBJParser.h"
+#include "TangentSpace.h"
 
 struct Vertex {
     glm::vec3 Position;
     glm::vec3 Normal;
     glm::vec2 TexCoords;
+    // 切线（xyz）与副切线方向（w为±1）：MikkTSpace的副切线为w * cross(Normal, Tangent)，
+    // fragment.glsl取其反方向（-w * cross(Normal, Tangent)），法线贴图的G通道按DirectX约定解释
+    glm::vec4 Tangent;
+};
+
+// 紧凑顶点格式（20字节）：位置为相对包围盒的16位归一化值，法线与切线为八面体映射后的2x16位有符号归一化值，
+// 纹理坐标为半精度浮点；副切线方向存在位置的第四个分量（0为-1，65535为+1）。
+// 着色器中按positionOffset、positionScale还原位置，按八面体映射还原法线与切线
+struct PackedVertex {
+    uint16_t Position[3];
+    uint16_t TangentSign;
+    int16_t Normal[2];
+    uint16_t TexCoords[2];
+    int16_t Tangent[2];
+};
+
+// 角点(v, vt, vn)索引三元组到焊接后顶点编号的开放寻址哈希表（线性探测），容量为2的幂且至少是元素数的两倍
+class CornerWeldMap {
+public:
+    static constexpr unsigned int EMPTY = 0xFFFFFFFFu;
+
+    explicit CornerWeldMap(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) {
+            capacity <<= 1;
+        }
+        mask = capacity - 1;
+        slots.assign(capacity, Slot{0, 0, 0, EMPTY});
+    }
+
+    // 返回三元组对应的顶点编号；不存在时以next插入，inserted置为true
+    unsigned int findOrInsert(unsigned int v, unsigned int vt, unsigned int vn, unsigned int next, bool& inserted) {
+        size_t slot = hash(v, vt, vn) & mask;
+        for (;;) {
+            Slot& entry = slots[slot];
+            if (entry.value == EMPTY) {
+                entry = Slot{v, vt, vn, next};
+                inserted = true;
+                return next;
+            }
+            if (entry.v == v && entry.vt == vt && entry.vn == vn) {
+                inserted = false;
+                return entry.value;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+private:
+    struct Slot {
+        unsigned int v, vt, vn;
+        unsigned int value;
+    };
+    std::vector<Slot> slots;
+    size_t mask;
+
+    static size_t hash(unsigned int v, unsigned int vt, unsigned int vn) {
+        uint64_t h = v * 0x9E3779B97F4A7C15ull;
+        h ^= (vt + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2)) * 0xBF58476D1CE4E5B9ull;
+        h ^= (vn + 0x94D049BB133111EBull + (h << 6) + (h >> 2)) * 0x94D049BB133111EBull;
+        return static_cast<size_t>(h ^ (h >> 31));
+    }
+};
+
+// 使用同一材质的一段连续索引
+struct SubMesh {
+    std::string material;
+    unsigned int indexOffset;
+    unsigned int indexCount;
 };
 
 class OBJLoader {
 public:
+    // 从OBJ解析时保存处理后的顶点与索引；从缓存加载时直接由映射的页面上传，这两个数组为空
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    GLuint VAO, VBO, EBO;
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    // 上传到GPU的顶点数、索引数与模型包围盒
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    // 按材质划分的索引范围，每种材质一段，顺序为材质在OBJ中首次出现的顺序
+    std::vector<SubMesh> subMeshes;
+    // 是否读写OBJ旁的二进制网格缓存（<源文件>.meshcache）
+    bool useCache = true;
+    // 上传前是否重排三角形与顶点（顶点缓存、过度绘制、顶点读取），需在prepare之前设置
+    bool optimizeLayout = true;
+    // 上传紧凑顶点格式（PackedVertex）而不是浮点格式（Vertex），需在prepare之前设置
+    bool compactVertices = true;
+    // 重排前后的平均缓存未命中率
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
     
-    bool loadOBJ(const std::string& path) {
-        std::vector<glm::vec3> temp_vertices;
-        std::vector<glm::vec2> temp_uvs;
-        std::vector<glm::vec3> temp_normals;
-        std::vector<unsigned int> vertex_indices, uv_indices, normal_indices;
-        
-        std::ifstream file(path);
-        if (!file.is_open()) {
+    // 加载阶段，prepare在加载线程中按顺序报告
+    enum LoadStage {
+        LOAD_PARSING,
+        LOAD_WELDING,
+        LOAD_TANGENTS,
+        LOAD_OPTIMIZING,
+        LOAD_WRITING_CACHE,
+        LOAD_READY,
+        LOAD_STAGE_COUNT
+    };
+    // 进入每个阶段时在加载线程中调用；报告LOAD_WELDING及之后的阶段时包围盒已确定
+    std::function<void(LoadStage)> onProgress;
+
+    // 加载的CPU部分（读取缓存或解析OBJ、焊接、重排、写缓存），不调用GL，可在工作线程执行；
+    // 成功后在GL线程调用upload。prepare完成前不要从其他线程读取本对象的字段
+    bool prepare(const std::string& path) {
+        MeshCache::SourceKey key = MeshCache::sourceKey(path);
+        std::string cacheFile = MeshCache::cachePath(path);
+        if (useCache && loadCache(cacheFile, key)) {
+            report(LOAD_READY);
+            std::cout << "OBJ loaded from cache: " << cached->header().vertexCount << " vertices, "
+                      << cached->header().indexCount / 3 << " triangles" << std::endl;
+            return true;
+        }
+
+        // 映射整个文件后解析，大文件分块并行
+        report(LOAD_PARSING);
+        MappedFile file;
+        if (!file.open(path)) {
             std::cerr << "Failed to open OBJ file: " << path << std::endl;
             return false;
         }
-        
-        std::string line;
-        while (std::getline(file, line)) {
-            std::istringstream iss(line);
-            std::string prefix;
-            iss >> prefix;
-            
-            if (prefix == "v") {
-                // 顶点位置
-                glm::vec3 vertex;
-                iss >> vertex.x >> vertex.y >> vertex.z;
-                temp_vertices.push_back(vertex);
-            }
-            else if (prefix == "vt") {
-                // 纹理坐标
-                glm::vec2 uv;
-                iss >> uv.x >> uv.y;
-                temp_uvs.push_back(uv);
-            }
-            else if (prefix == "vn") {
-                // 法线
-                glm::vec3 normal;
-                iss >> normal.x >> normal.y >> normal.z;
-                temp_normals.push_back(normal);
-            }
-            else if (prefix == "f") {
-                // 面
-                std::string vertex1, vertex2, vertex3;
-                iss >> vertex1 >> vertex2 >> vertex3;
-                
-                parseVertex(vertex1, vertex_indices, uv_indices, normal_indices);
-                parseVertex(vertex2, vertex_indices, uv_indices, normal_indices);
-                parseVertex(vertex3, vertex_indices, uv_indices, normal_indices);
-            }
-        }
-        
+        OBJParser::OBJData data;
+        OBJParser::parseParallel(file.data(), file.data() + file.size(), data);
         file.close();
-        
+        computeBounds(data.positions);
+        report(LOAD_WELDING);
+
         // 如果没有法线，生成法线
-        bool hasNormals = !temp_normals.empty() && normal_indices.size() == vertex_indices.size();
+        bool hasNormals = !data.normals.empty() && data.normalIndices.size() == data.vertexIndices.size();
         if (!hasNormals) {
             std::cout << "No normals found in OBJ file, generating normals..." << std::endl;
-            temp_normals = generateNormals(temp_vertices, vertex_indices);
-            normal_indices = vertex_indices; // 使用相同的索引
+            data.normals = generateNormals(data.positions, data.vertexIndices);
+            data.normalIndices = data.vertexIndices; // 使用相同的索引
         }
         
         // 构建最终的顶点数据
-        buildVertexData(temp_vertices, temp_uvs, temp_normals, 
-                       vertex_indices, uv_indices, normal_indices, hasNormals);
-        
-        setupMesh();
+        buildVertexData(data.positions, data.texCoords, data.normals, 
+                       data.vertexIndices, data.uvIndices, data.normalIndices, hasNormals, data.materials);
+        groupByMaterial(data.materials);
+        report(LOAD_TANGENTS);
+        TangentSpace::generate(vertices, indices);
+
+        acmrBefore = MeshOptimizer::computeACMR(indices, vertices.size());
+        acmrAfter = acmrBefore;
+        if (optimizeLayout) {
+            report(LOAD_OPTIMIZING);
+            optimizeMesh();
+            acmrAfter = MeshOptimizer::computeACMR(indices, vertices.size());
+        }
+        std::cout << "ACMR: " << acmrBefore << " -> " << acmrAfter << std::endl;
+
+        computeBounds();
+        if (compactVertices) {
+            packed = packVertices();
+        }
+        if (useCache && key.valid) {
+            report(LOAD_WRITING_CACHE);
+            if (!writeCache(cacheFile, key, uploadData())) {
+                std::cerr << "Failed to write mesh cache: " << cacheFile << std::endl;
+            }
+        }
+        report(LOAD_READY);
         
-        std::cout << "OBJ loaded successfully: " << vertices.size() << " vertices, " 
-                  << indices.size() / 3 << " triangles" << std::endl;
+        std::cout << "OBJ loaded successfully: " << vertices.size() << " vertices (welded from "
+                  << indices.size() << " corners), " << indices.size() / 3 << " triangles, "
+                  << vertexStride() << " bytes per vertex" << std::endl;
         return true;
     }
-    
-private:
-    void parseVertex(const std::string& vertex, 
-                    std::vector<unsigned int>& vertex_indices,
-                    std::vector<unsigned int>& uv_indices,
-                    std::vector<unsigned int>& normal_indices) {
-        std::istringstream iss(vertex);
-        std::string token;
-        
-        // 解析 "v/vt/vn" 格式
-        if (std::getline(iss, token, '/')) {
-            vertex_indices.push_back(std::stoi(token) - 1); // OBJ索引从1开始
-        }
-        if (std::getline(iss, token, '/')) {
-            if (!token.empty()) {
-                uv_indices.push_back(std::stoi(token) - 1);
-            }
+
+    // 加载的GL部分：把prepare准备好的数据上传到GPU，需在GL线程调用
+    void upload() {
+        if (cached) {
+            setupMesh(cached->vertices(), cached->header().vertexCount, cached->indices(),
+                      cached->header().indexCount);
+            cached.reset();
+        } else {
+            setupMesh(uploadData(), vertices.size(), indices.data(), indices.size());
+            packed.clear();
+            packed.shrink_to_fit();
         }
-        if (std::getline(iss, token)) {
-            if (!token.empty()) {
-                normal_indices.push_back(std::stoi(token) - 1);
-            }
+    }
+
+    // 每个顶点在顶点缓冲中的字节数
+    size_t vertexStride() const {
+        return compactVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+
+    // 设置顶点着色器还原紧凑格式所需的uniform，需在绘制前、着色器程序使用中调用
+    void setVertexFormatUniforms(GLuint shaderProgram) const {
+        glm::vec3 offset(0.0f), scale(1.0f);
+        if (compactVertices) {
+            offset = boundsMin;
+            scale = boundsMax - boundsMin;
         }
+        glUniform3fv(glGetUniformLocation(shaderProgram, "positionOffset"), 1, &offset[0]);
+        glUniform3fv(glGetUniformLocation(shaderProgram, "positionScale"), 1, &scale[0]);
+        glUniform1i(glGetUniformLocation(shaderProgram, "packedNormal"), compactVertices ? 1 : 0);
     }
     
+private:
+    // prepare的结果：有效的缓存保持映射直到upload；紧凑格式的顶点数据在upload后释放
+    std::unique_ptr<MeshCache::Reader> cached;
+    std::vector<PackedVertex> packed;
+
+    void report(LoadStage stage) {
+        if (onProgress) {
+            onProgress(stage);
+        }
+    }
+
+    // 实际上传的顶点数据（与compactVertices对应的格式）
+    const void* uploadData() const {
+        return compactVertices ? static_cast<const void*>(packed.data()) : vertices.data();
+    }
+
     std::vector<glm::vec3> generateNormals(const std::vector<glm::vec3>& vertices,
                                           const std::vector<unsigned int>& indices) {
         std::vector<glm::vec3> normals(vertices.size(), glm::vec3(0.0f));
@@ -122,6 +252,10 @@ private:
             unsigned int i0 = indices[i];
             unsigned int i1 = indices[i + 1];
             unsigned int i2 = indices[i + 2];
+            // 索引越界的三角形在buildVertexData中丢弃
+            if (i0 >= vertices.size() || i1 >= vertices.size() || i2 >= vertices.size()) {
+                continue;
+            }
             
             glm::vec3 v0 = vertices[i0];
             glm::vec3 v1 = vertices[i1];
@@ -146,44 +280,262 @@ private:
         return normals;
     }
     
+    // 顶点或法线索引越界（正数索引超出已声明的数量）的三角形被丢弃，runs中的三角形编号随之调整
     void buildVertexData(const std::vector<glm::vec3>& temp_vertices,
                         const std::vector<glm::vec2>& temp_uvs,
                         const std::vector<glm::vec3>& temp_normals,
                         const std::vector<unsigned int>& vertex_indices,
                         const std::vector<unsigned int>& uv_indices,
                         const std::vector<unsigned int>& normal_indices,
-                        bool hasOriginalNormals) {
+                        bool hasOriginalNormals,
+                        std::vector<OBJParser::MaterialRun>& runs) {
         
         vertices.clear();
         indices.clear();
         
-        // 创建唯一的顶点
-        for (size_t i = 0; i < vertex_indices.size(); i++) {
-            Vertex vertex;
-            
-            // 位置
-            vertex.Position = temp_vertices[vertex_indices[i]];
-            
-            // 纹理坐标
-            if (i < uv_indices.size() && uv_indices[i] < temp_uvs.size()) {
-                vertex.TexCoords = temp_uvs[uv_indices[i]];
-            } else {
-                vertex.TexCoords = glm::vec2(0.0f);
+        // 焊接(v, vt, vn)相同的角点，索引缓冲共享顶点
+        size_t cornerCount = vertex_indices.size() / 3 * 3;
+        CornerWeldMap weldMap(cornerCount);
+        indices.reserve(cornerCount);
+        size_t run = 0;
+        for (size_t first = 0; first < cornerCount; first += 3) {
+            for (; run < runs.size() && runs[run].firstTriangle <= first / 3; run++) {
+                runs[run].firstTriangle = indices.size() / 3;
             }
-            
-            // 法线
-            if (hasOriginalNormals && i < normal_indices.size()) {
-                vertex.Normal = temp_normals[normal_indices[i]];
-            } else {
-                vertex.Normal = temp_normals[vertex_indices[i]];
+            bool valid = true;
+            for (size_t i = first; i < first + 3; i++) {
+                unsigned int normal = (hasOriginalNormals && i < normal_indices.size()) ? normal_indices[i]
+                                                                                       : vertex_indices[i];
+                valid = valid && vertex_indices[i] < temp_vertices.size() && normal < temp_normals.size();
             }
-            
-            vertices.push_back(vertex);
-            indices.push_back(i);
+            if (!valid) {
+                continue;
+            }
+            for (size_t i = first; i < first + 3; i++) {
+                // 纹理坐标与法线的实际来源，与焊接前逐角点取值的规则相同
+                unsigned int uv = (i < uv_indices.size() && uv_indices[i] < temp_uvs.size()) ? uv_indices[i]
+                                                                                           : CornerWeldMap::EMPTY;
+                unsigned int normal = (hasOriginalNormals && i < normal_indices.size()) ? normal_indices[i]
+                                                                                       : vertex_indices[i];
+                bool inserted = false;
+                unsigned int index = weldMap.findOrInsert(vertex_indices[i], uv, normal,
+                                                          static_cast<unsigned int>(vertices.size()), inserted);
+                if (inserted) {
+                    Vertex vertex;
+                    vertex.Position = temp_vertices[vertex_indices[i]];
+                    vertex.TexCoords = uv != CornerWeldMap::EMPTY ? temp_uvs[uv] : glm::vec2(0.0f);
+                    vertex.Normal = temp_normals[normal];
+                    vertices.push_back(vertex);
+                }
+                indices.push_back(index);
+            }
+        }
+        for (; run < runs.size(); run++) {
+            runs[run].firstTriangle = indices.size() / 3;
+        }
+    }
+    
+    void groupByMaterial(const std::vector<OBJParser::MaterialRun>& runs) {
+        size_t triangleCount = indices.size() / 3;
+        subMeshes.clear();
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // 每个三角形所属材质在subMeshes中的编号
+        std::vector<unsigned int> triangleMaterial(triangleCount, 0);
+        std::vector<unsigned int> runMaterial(runs.size());
+        size_t firstRun = runs.empty() ? triangleCount : std::min(runs.front().firstTriangle, triangleCount);
+        if (firstRun > 0) {
+            // 第一条usemtl之前的三角形使用默认材质
+            subMeshes.push_back({std::string(), 0, 0});
+        }
+        for (size_t r = 0; r < runs.size(); r++) {
+            size_t begin = std::min(runs[r].firstTriangle, triangleCount);
+            size_t end = r + 1 < runs.size() ? std::min(runs[r + 1].firstTriangle, triangleCount) : triangleCount;
+            if (begin >= end) {
+                continue;
+            }
+            unsigned int id = 0;
+            while (id < subMeshes.size() && subMeshes[id].material != runs[r].name) {
+                id++;
+            }
+            if (id == subMeshes.size()) {
+                subMeshes.push_back({runs[r].name, 0, 0});
+            }
+            std::fill(triangleMaterial.begin() + begin, triangleMaterial.begin() + end, id);
+        }
+        if (subMeshes.size() <= 1) {
+            subMeshes.resize(1);
+            subMeshes[0].indexOffset = 0;
+            subMeshes[0].indexCount = static_cast<unsigned int>(indices.size());
+            return;
+        }
+
+        // 计数排序
+        for (unsigned int id : triangleMaterial) {
+            subMeshes[id].indexCount += 3;
+        }
+        std::vector<unsigned int> cursor(subMeshes.size());
+        unsigned int offset = 0;
+        for (size_t id = 0; id < subMeshes.size(); id++) {
+            subMeshes[id].indexOffset = offset;
+            cursor[id] = offset;
+            offset += subMeshes[id].indexCount;
+        }
+        std::vector<unsigned int> grouped(indices.size());
+        for (size_t t = 0; t < triangleCount; t++) {
+            unsigned int& at = cursor[triangleMaterial[t]];
+            std::copy(indices.begin() + t * 3, indices.begin() + t * 3 + 3, grouped.begin() + at);
+            at += 3;
+        }
+        indices.swap(grouped);
+    }
+
+    // 各子网格分别重排三角形（不跨越材质边界），最后统一重排顶点
+    void optimizeMesh() {
+        std::vector<unsigned int> range;
+        std::vector<unsigned int> clusters;
+        for (const SubMesh& subMesh : subMeshes) {
+            auto begin = indices.begin() + subMesh.indexOffset;
+            range.assign(begin, begin + subMesh.indexCount);
+            MeshOptimizer::optimizeVertexCache(range, vertices.size(), clusters);
+            MeshOptimizer::optimizeOverdraw(range, vertices, clusters);
+            std::copy(range.begin(), range.end(), begin);
+        }
+        MeshOptimizer::optimizeVertexFetch(vertices, indices);
+    }
+    
+    uint32_t cacheFlags() const {
+        return (optimizeLayout ? MeshCache::FLAG_OPTIMIZED_LAYOUT : 0u) |
+               (compactVertices ? MeshCache::FLAG_COMPACT_VERTICES : 0u);
+    }
+
+    // 缓存有效时保持映射，upload直接从映射的页面上传；返回false表示需要重新解析OBJ
+    bool loadCache(const std::string& cacheFile, const MeshCache::SourceKey& key) {
+        auto reader = std::make_unique<MeshCache::Reader>();
+        if (!reader->open(cacheFile, key, cacheFlags(), static_cast<uint32_t>(vertexStride()))) {
+            return false;
+        }
+        const MeshCache::Header& header = reader->header();
+        boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        acmrBefore = header.acmrBefore;
+        acmrAfter = header.acmrAfter;
+        subMeshes.clear();
+        const MeshCache::Range* ranges = reader->ranges();
+        for (uint32_t r = 0; r < header.rangeCount; r++) {
+            if (uint64_t(ranges[r].indexOffset) + ranges[r].indexCount > header.indexCount) {
+                return false;
+            }
+            size_t length = strnlen(ranges[r].material, sizeof(ranges[r].material));
+            subMeshes.push_back({std::string(ranges[r].material, length), ranges[r].indexOffset, ranges[r].indexCount});
+        }
+        vertices.clear();
+        indices.clear();
+        cached = std::move(reader);
+        return true;
+    }
+
+    // vertexData为实际上传的顶点数据（与compactVertices对应的格式）
+    bool writeCache(const std::string& cacheFile, const MeshCache::SourceKey& key, const void* vertexData) const {
+        MeshCache::Header header = {};
+        header.sourceSize = key.size;
+        header.sourceTime = key.time;
+        header.flags = cacheFlags();
+        header.vertexStride = static_cast<uint32_t>(vertexStride());
+        header.vertexCount = static_cast<uint32_t>(vertices.size());
+        header.indexCount = static_cast<uint32_t>(indices.size());
+        for (int k = 0; k < 3; k++) {
+            header.boundsMin[k] = boundsMin[k];
+            header.boundsMax[k] = boundsMax[k];
+        }
+        header.acmrBefore = acmrBefore;
+        header.acmrAfter = acmrAfter;
+        std::vector<MeshCache::Range> ranges(subMeshes.size());
+        for (size_t r = 0; r < subMeshes.size(); r++) {
+            // 名称过长的材质无法存入缓存
+            if (subMeshes[r].material.size() >= sizeof(ranges[r].material)) {
+                return false;
+            }
+            ranges[r].indexOffset = subMeshes[r].indexOffset;
+            ranges[r].indexCount = subMeshes[r].indexCount;
+            std::memset(ranges[r].material, 0, sizeof(ranges[r].material));
+            std::memcpy(ranges[r].material, subMeshes[r].material.data(), subMeshes[r].material.size());
+        }
+        return MeshCache::write(cacheFile, header, vertexData, indices.data(), ranges);
+    }
+
+    // 焊接后只统计被引用的顶点
+    void computeBounds() {
+        if (vertices.empty()) {
+            boundsMin = boundsMax = glm::vec3(0.0f);
+            return;
+        }
+        boundsMin = boundsMax = vertices[0].Position;
+        for (const Vertex& vertex : vertices) {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+    }
+
+    // 解析后立即得到的包围盒（包含未被面引用的顶点），用于加载期间的代理显示
+    void computeBounds(const std::vector<glm::vec3>& positions) {
+        if (positions.empty()) {
+            boundsMin = boundsMax = glm::vec3(0.0f);
+            return;
+        }
+        boundsMin = boundsMax = positions[0];
+        for (const glm::vec3& position : positions) {
+            boundsMin = glm::min(boundsMin, position);
+            boundsMax = glm::max(boundsMax, position);
+        }
+    }
+    
+    // 单位向量的八面体映射，结果在[-1, 1]^2内
+    static glm::vec2 octEncode(glm::vec3 n) {
+        float length = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+        if (!(length > 0.0f) || !std::isfinite(length)) {
+            return glm::vec2(0.0f);
+        }
+        n /= length;
+        glm::vec2 p(n.x, n.y);
+        if (n.z < 0.0f) {
+            p = glm::vec2((1.0f - std::fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                          (1.0f - std::fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
         }
+        return p;
+    }
+
+    std::vector<PackedVertex> packVertices() const {
+        std::vector<PackedVertex> packed(vertices.size());
+        glm::vec3 extent = boundsMax - boundsMin;
+        // 包围盒某一维厚度为0时该维全部量化为0
+        glm::vec3 inverse(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+                          extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex& vertex = vertices[i];
+            PackedVertex& out = packed[i];
+            glm::vec3 position = glm::clamp((vertex.Position - boundsMin) * inverse, 0.0f, 1.0f);
+            for (int k = 0; k < 3; k++) {
+                out.Position[k] = static_cast<uint16_t>(std::lround(position[k] * 65535.0f));
+            }
+            out.TangentSign = vertex.Tangent.w < 0.0f ? 0 : 65535;
+            glm::vec2 normal = octEncode(vertex.Normal);
+            glm::vec2 tangent = octEncode(glm::vec3(vertex.Tangent));
+            for (int k = 0; k < 2; k++) {
+                out.Normal[k] = static_cast<int16_t>(std::lround(glm::clamp(normal[k], -1.0f, 1.0f) * 32767.0f));
+                out.TexCoords[k] = static_cast<uint16_t>(glm::packHalf1x16(vertex.TexCoords[k]));
+                out.Tangent[k] = static_cast<int16_t>(std::lround(glm::clamp(tangent[k], -1.0f, 1.0f) * 32767.0f));
+            }
+        }
+        return packed;
     }
     
-    void setupMesh() {
+    void setupMesh(const void* vertexData, size_t numVertices, const unsigned int* indexData, size_t numIndices) {
+        vertexCount = numVertices;
+        indexCount = numIndices;
+
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
@@ -191,22 +543,40 @@ private:
         glBindVertexArray(VAO);
         
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, numVertices * vertexStride(), vertexData, GL_STATIC_DRAW);
         
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-        
-        // 顶点位置
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
-        
-        // 法线
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        glEnableVertexAttribArray(1);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
         
-        // 纹理坐标
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        glEnableVertexAttribArray(2);
+        if (compactVertices) {
+            GLsizei stride = sizeof(PackedVertex);
+            // 第四个分量为副切线方向
+            glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, Position));
+            glEnableVertexAttribArray(0);
+            // 八面体映射的法线与切线只有两个分量，着色器中还原
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, Normal));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, TexCoords));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, Tangent));
+            glEnableVertexAttribArray(3);
+        } else {
+            // 顶点位置
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+            glEnableVertexAttribArray(0);
+            
+            // 法线
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+            glEnableVertexAttribArray(1);
+            
+            // 纹理坐标
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+            glEnableVertexAttribArray(2);
+
+            // 切线
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+            glEnableVertexAttribArray(3);
+        }
         
         glBindVertexArray(0);
     }
@@ -214,9 +584,15 @@ private:
 public:
     void draw() {
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indexCount), GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
     }
+
+    // 只绘制一个子网格，调用前需绑定VAO（各子网格共用同一组VBO/EBO）
+    void drawSubMesh(const SubMesh& subMesh) const {
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(subMesh.indexCount), GL_UNSIGNED_INT,
+                       (void*)(static_cast<size_t>(subMesh.indexOffset) * sizeof(unsigned int)));
+    }
     
     ~OBJLoader() {
         if (VAO != 0) {
@@ -0,0 +1,449 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Parallel.h"
+
+// OBJ文本解析：直接在内存（通常是映射的文件）上逐行扫描，用std::from_chars读取数字，
+// 不创建string/stringstream，数组按记录数预先分配
+namespace OBJParser {
+
+// 索引缺失或无效时的取值
+constexpr unsigned int INVALID_INDEX = 0xFFFFFFFFu;
+
+// usemtl记录：从第firstTriangle个三角形起使用名为name的材质，直到下一条记录
+struct MaterialRun {
+    std::string name;
+    size_t firstTriangle;
+};
+
+// 解析结果，面的索引已转换为从0开始
+struct OBJData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    // 每个三角形角点一项；纹理坐标与法线索引只在面中给出时才有（与原先的解析方式一致）
+    std::vector<unsigned int> vertexIndices;
+    std::vector<unsigned int> uvIndices;
+    std::vector<unsigned int> normalIndices;
+    // 按出现顺序排列；第一条记录之前的三角形没有指定材质
+    std::vector<MaterialRun> materials;
+};
+
+// 各类记录的数量
+struct RecordCounts {
+    size_t positions = 0;
+    size_t texCoords = 0;
+    size_t normals = 0;
+    // 三角形角点数的估计（按每个面一个三角形计）
+    size_t corners = 0;
+};
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* lineEnd(const char* p, const char* end) {
+    const void* found = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return found ? static_cast<const char*>(found) : end;
+}
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+inline const char* parseFloat(const char* p, const char* end, float& value) {
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        value = 0.0f;
+        return p;
+    }
+    return result.ptr;
+}
+
+// 读取一个整数，没有数字时返回false
+inline bool parseInt(const char*& p, const char* end, long long& value) {
+    const char* start = p;
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        p = start;
+        return false;
+    }
+    p = result.ptr;
+    return true;
+}
+
+// 把OBJ索引（从1开始，负数表示相对于已读取的数量）转换为从0开始的索引
+inline unsigned int resolveIndex(long long index, size_t count) {
+    if (index > 0) {
+        return static_cast<unsigned int>(index - 1);
+    }
+    if (index < 0 && static_cast<size_t>(-index) <= count) {
+        return static_cast<unsigned int>(static_cast<long long>(count) + index);
+    }
+    return INVALID_INDEX;
+}
+
+// 统计记录数，用于预留数组
+inline RecordCounts countRecords(const char* begin, const char* end) {
+    RecordCounts counts;
+    for (const char* p = begin; p < end;) {
+        const char* next = lineEnd(p, end);
+        p = skipSpaces(p, next);
+        if (next - p >= 2) {
+            if (p[0] == 'v' && isSpace(p[1])) {
+                counts.positions++;
+            } else if (p[0] == 'v' && p[1] == 't') {
+                counts.texCoords++;
+            } else if (p[0] == 'v' && p[1] == 'n') {
+                counts.normals++;
+            } else if (p[0] == 'f' && isSpace(p[1])) {
+                counts.corners += 3;
+            }
+        }
+        p = next + 1;
+    }
+    return counts;
+}
+
+// 以相对顶点索引开头的面的一段三角形：该索引拼接后无效时，串行解析会在这个角点处放弃面的剩余部分，
+// 对应丢弃本块的第firstTriangle到第endTriangle个三角形（不含）
+struct FaceCut {
+    unsigned int vertex;
+    size_t firstTriangle;
+    size_t endTriangle;
+};
+
+// 分块解析时负数索引的位置：这些索引先记为相对于本块起点的值（可能为负），拼接时再加上前面各块的数量
+struct RelativeIndices {
+    std::vector<size_t> vertex;
+    std::vector<size_t> uv;
+    std::vector<size_t> normal;
+    std::vector<FaceCut> cuts;
+};
+
+// 面中的一个角点
+struct Corner {
+    unsigned int vertex;
+    unsigned int uv;
+    unsigned int normal;
+    // 第0、1、2位分别表示vertex、uv、normal是相对于本块起点的值
+    unsigned int relative;
+};
+
+// 把OBJ索引转换为从0开始的索引；relative不为空（分块解析）时负数索引只换算到本块起点，并置位bit
+inline unsigned int resolveCorner(long long index, size_t count, unsigned int* relative, unsigned int bit) {
+    if (index < 0 && relative != nullptr) {
+        *relative |= bit;
+        // 超出int范围的值拼接后必然无效
+        long long value = std::max(static_cast<long long>(count) + index, static_cast<long long>(INT_MIN));
+        return static_cast<unsigned int>(static_cast<int>(value));
+    }
+    return resolveIndex(index, count);
+}
+
+// 解析"v"、"v/vt"、"v//vn"、"v/vt/vn"形式的角点；positionCount等为负数（相对）索引的参照数量
+inline bool parseCorner(const char*& p, const char* end, size_t positionCount, size_t uvCount, size_t normalCount,
+                        bool chunked, Corner& corner) {
+    long long value = 0;
+    if (!parseInt(p, end, value)) {
+        return false;
+    }
+    corner.relative = 0;
+    unsigned int* relative = chunked ? &corner.relative : nullptr;
+    corner.vertex = resolveCorner(value, positionCount, relative, 1);
+    corner.uv = INVALID_INDEX;
+    corner.normal = INVALID_INDEX;
+    if (p < end && *p == '/') {
+        ++p;
+        if (p < end && *p != '/' && parseInt(p, end, value)) {
+            corner.uv = resolveCorner(value, uvCount, relative, 2);
+        }
+        if (p < end && *p == '/') {
+            ++p;
+            if (parseInt(p, end, value)) {
+                corner.normal = resolveCorner(value, normalCount, relative, 4);
+            }
+        }
+    }
+    // 跳过角点中无法识别的剩余字符
+    while (p < end && !isSpace(*p) && *p != '\r') {
+        ++p;
+    }
+    return (corner.relative & 1) || corner.vertex != INVALID_INDEX;
+}
+
+inline void pushCorner(const Corner& corner, OBJData& data, RelativeIndices* relative) {
+    if (relative != nullptr) {
+        // 分块解析时纹理坐标与法线索引和角点一一对应（缺失记为INVALID_INDEX），拼接前由finishChunk去掉缺失项
+        if (corner.relative & 1) {
+            relative->vertex.push_back(data.vertexIndices.size());
+        }
+        if (corner.relative & 2) {
+            relative->uv.push_back(data.uvIndices.size());
+        }
+        if (corner.relative & 4) {
+            relative->normal.push_back(data.normalIndices.size());
+        }
+        data.vertexIndices.push_back(corner.vertex);
+        data.uvIndices.push_back(corner.uv);
+        data.normalIndices.push_back(corner.normal);
+        return;
+    }
+    data.vertexIndices.push_back(corner.vertex);
+    if (corner.uv != INVALID_INDEX) {
+        data.uvIndices.push_back(corner.uv);
+    }
+    if (corner.normal != INVALID_INDEX) {
+        data.normalIndices.push_back(corner.normal);
+    }
+}
+
+// 解析一行面记录（p指向"f"之后），多边形按扇形拆成三角形
+inline void parseFace(const char* p, const char* end, OBJData& data, RelativeIndices* relative) {
+    size_t positionCount = data.positions.size();
+    size_t uvCount = data.texCoords.size();
+    size_t normalCount = data.normals.size();
+    Corner first{}, previous{}, corner{};
+    int count = 0;
+    size_t faceTriangle = data.vertexIndices.size() / 3;
+    size_t firstCut = relative != nullptr ? relative->cuts.size() : 0;
+    for (;;) {
+        p = skipSpaces(p, end);
+        if (p >= end || *p == '#') {
+            break;
+        }
+        if (!parseCorner(p, end, positionCount, uvCount, normalCount, relative != nullptr, corner)) {
+            break;
+        }
+        if (corner.relative & 1) {
+            // 第count个角点无效时，串行解析只输出它之前的count - 2个三角形
+            relative->cuts.push_back({corner.vertex, faceTriangle + std::max(count - 2, 0), 0});
+        }
+        if (count == 0) {
+            first = corner;
+        } else if (count >= 2) {
+            pushCorner(first, data, relative);
+            pushCorner(previous, data, relative);
+            pushCorner(corner, data, relative);
+        }
+        previous = corner;
+        count++;
+    }
+    if (relative != nullptr) {
+        for (size_t c = firstCut; c < relative->cuts.size(); c++) {
+            relative->cuts[c].endTriangle = data.vertexIndices.size() / 3;
+        }
+    }
+}
+
+// 解析[begin, end)中的OBJ文本，结果追加到data；relative不为空时按分块方式记录负数索引
+inline void parse(const char* begin, const char* end, OBJData& data, RelativeIndices* relative = nullptr) {
+    RecordCounts counts = countRecords(begin, end);
+    data.positions.reserve(data.positions.size() + counts.positions);
+    data.texCoords.reserve(data.texCoords.size() + counts.texCoords);
+    data.normals.reserve(data.normals.size() + counts.normals);
+    data.vertexIndices.reserve(data.vertexIndices.size() + counts.corners);
+    data.uvIndices.reserve(data.uvIndices.size() + counts.corners);
+    data.normalIndices.reserve(data.normalIndices.size() + counts.corners);
+
+    for (const char* p = begin; p < end;) {
+        const char* next = lineEnd(p, end);
+        p = skipSpaces(p, next);
+        if (next - p >= 2) {
+            if (p[0] == 'v' && isSpace(p[1])) {
+                // 顶点位置
+                glm::vec3 position;
+                const char* q = parseFloat(p + 1, next, position.x);
+                q = parseFloat(q, next, position.y);
+                parseFloat(q, next, position.z);
+                data.positions.push_back(position);
+            } else if (p[0] == 'v' && p[1] == 't') {
+                // 纹理坐标
+                glm::vec2 uv;
+                const char* q = parseFloat(p + 2, next, uv.x);
+                parseFloat(q, next, uv.y);
+                data.texCoords.push_back(uv);
+            } else if (p[0] == 'v' && p[1] == 'n') {
+                // 法线
+                glm::vec3 normal;
+                const char* q = parseFloat(p + 2, next, normal.x);
+                q = parseFloat(q, next, normal.y);
+                parseFloat(q, next, normal.z);
+                data.normals.push_back(normal);
+            } else if (p[0] == 'f' && isSpace(p[1])) {
+                // 面
+                parseFace(p + 1, next, data, relative);
+            } else if (next - p > 6 && std::memcmp(p, "usemtl", 6) == 0 && isSpace(p[6])) {
+                // 材质
+                const char* name = skipSpaces(p + 6, next);
+                const char* nameEnd = next;
+                while (nameEnd > name && (isSpace(nameEnd[-1]) || nameEnd[-1] == '\r')) {
+                    --nameEnd;
+                }
+                data.materials.push_back({std::string(name, nameEnd), data.vertexIndices.size() / 3});
+            }
+        }
+        p = next + 1;
+    }
+}
+
+// 每块至少这么多字节，小文件直接串行解析
+constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+// 把本块的相对索引加上前面各块的数量，超出范围时返回INVALID_INDEX
+inline unsigned int rebaseIndex(unsigned int index, size_t base) {
+    long long value = static_cast<long long>(static_cast<int>(index)) + static_cast<long long>(base);
+    return value >= 0 ? static_cast<unsigned int>(value) : INVALID_INDEX;
+}
+
+inline void rebaseRelative(std::vector<unsigned int>& indices, const std::vector<size_t>& positions, size_t base) {
+    for (size_t position : positions) {
+        indices[position] = rebaseIndex(indices[position], base);
+    }
+}
+
+// 把分块解析的结果整理成与parse相同的形式：换算相对索引，丢弃串行解析会放弃的三角形，
+// 去掉缺失（或无效）的纹理坐标与法线索引，材质记录的三角形编号随之调整
+inline void finishChunk(OBJData& chunk, const RelativeIndices& relative, size_t positionBase, size_t uvBase,
+                        size_t normalBase) {
+    rebaseRelative(chunk.vertexIndices, relative.vertex, positionBase);
+    rebaseRelative(chunk.uvIndices, relative.uv, uvBase);
+    rebaseRelative(chunk.normalIndices, relative.normal, normalBase);
+
+    size_t triangleCount = chunk.vertexIndices.size() / 3;
+    std::vector<char> keep(triangleCount, 1);
+    for (const FaceCut& cut : relative.cuts) {
+        if (rebaseIndex(cut.vertex, positionBase) == INVALID_INDEX) {
+            std::fill(keep.begin() + cut.firstTriangle, keep.begin() + cut.endTriangle, 0);
+        }
+    }
+
+    // 原地压缩，写入位置不超过读取位置
+    size_t vertexOut = 0, uvOut = 0, normalOut = 0, run = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (; run < chunk.materials.size() && chunk.materials[run].firstTriangle <= t; run++) {
+            chunk.materials[run].firstTriangle = vertexOut / 3;
+        }
+        if (!keep[t]) {
+            continue;
+        }
+        for (size_t i = t * 3; i < t * 3 + 3; i++) {
+            chunk.vertexIndices[vertexOut++] = chunk.vertexIndices[i];
+            if (chunk.uvIndices[i] != INVALID_INDEX) {
+                chunk.uvIndices[uvOut++] = chunk.uvIndices[i];
+            }
+            if (chunk.normalIndices[i] != INVALID_INDEX) {
+                chunk.normalIndices[normalOut++] = chunk.normalIndices[i];
+            }
+        }
+    }
+    for (; run < chunk.materials.size(); run++) {
+        chunk.materials[run].firstTriangle = vertexOut / 3;
+    }
+    chunk.vertexIndices.resize(vertexOut);
+    chunk.uvIndices.resize(uvOut);
+    chunk.normalIndices.resize(normalOut);
+}
+
+template <typename T>
+inline void appendAt(std::vector<T>& target, size_t offset, const std::vector<T>& source) {
+    std::copy(source.begin(), source.end(), target.begin() + offset);
+}
+
+// 在行边界处把文件分成多块，各块在工作线程上解析，再按前缀和拼接；结果与parse完全相同
+// threads为0时使用全部核心，文件较小时退化为串行解析
+inline void parseParallel(const char* begin, const char* end, OBJData& data, int threads = 0) {
+    size_t size = static_cast<size_t>(end - begin);
+    if (threads <= 0) {
+        threads = workerCount();
+    }
+    int chunkCount = static_cast<int>(std::min<size_t>(static_cast<size_t>(threads), size / MIN_CHUNK_BYTES));
+    if (chunkCount <= 1) {
+        parse(begin, end, data);
+        return;
+    }
+
+    // 每块从上一块结束处开始，到目标位置之后的第一个换行符为止
+    std::vector<const char*> bounds(chunkCount + 1, end);
+    bounds[0] = begin;
+    for (int i = 1; i < chunkCount; i++) {
+        const char* target = std::max(begin + size * i / chunkCount, bounds[i - 1]);
+        const char* newline = lineEnd(target, end);
+        bounds[i] = newline < end ? newline + 1 : end;
+    }
+
+    std::vector<OBJData> chunks(chunkCount);
+    std::vector<RelativeIndices> relatives(chunkCount);
+    parallelFor(chunkCount, [&](int i) { parse(bounds[i], bounds[i + 1], chunks[i], &relatives[i]); }, threads);
+
+    // 各块的顶点、纹理坐标、法线在结果中的起始位置
+    std::vector<size_t> positionBase(chunkCount + 1, 0), uvBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0);
+    for (int i = 0; i < chunkCount; i++) {
+        positionBase[i + 1] = positionBase[i] + chunks[i].positions.size();
+        uvBase[i + 1] = uvBase[i] + chunks[i].texCoords.size();
+        normalBase[i + 1] = normalBase[i] + chunks[i].normals.size();
+    }
+    size_t positionStart = data.positions.size();
+    size_t uvStart = data.texCoords.size();
+    size_t normalStart = data.normals.size();
+    parallelFor(chunkCount, [&](int i) {
+        finishChunk(chunks[i], relatives[i], positionStart + positionBase[i], uvStart + uvBase[i],
+                    normalStart + normalBase[i]);
+    }, threads);
+
+    // 整理后各块的索引在结果中的起始位置
+    std::vector<size_t> vertexIndexBase(chunkCount + 1, 0), uvIndexBase(chunkCount + 1, 0), normalIndexBase(chunkCount + 1, 0);
+    for (int i = 0; i < chunkCount; i++) {
+        vertexIndexBase[i + 1] = vertexIndexBase[i] + chunks[i].vertexIndices.size();
+        uvIndexBase[i + 1] = uvIndexBase[i] + chunks[i].uvIndices.size();
+        normalIndexBase[i + 1] = normalIndexBase[i] + chunks[i].normalIndices.size();
+    }
+    data.positions.resize(positionStart + positionBase[chunkCount]);
+    data.texCoords.resize(uvStart + uvBase[chunkCount]);
+    data.normals.resize(normalStart + normalBase[chunkCount]);
+    size_t vertexIndexStart = data.vertexIndices.size();
+    size_t uvIndexStart = data.uvIndices.size();
+    size_t normalIndexStart = data.normalIndices.size();
+    // 材质记录量很小，串行拼接；三角形编号加上前面各块的三角形数
+    for (int i = 0; i < chunkCount; i++) {
+        for (MaterialRun& run : chunks[i].materials) {
+            run.firstTriangle += (vertexIndexStart + vertexIndexBase[i]) / 3;
+            data.materials.push_back(std::move(run));
+        }
+    }
+    data.vertexIndices.resize(vertexIndexStart + vertexIndexBase[chunkCount]);
+    data.uvIndices.resize(uvIndexStart + uvIndexBase[chunkCount]);
+    data.normalIndices.resize(normalIndexStart + normalIndexBase[chunkCount]);
+
+    parallelFor(chunkCount, [&](int i) {
+        OBJData& chunk = chunks[i];
+        appendAt(data.positions, positionStart + positionBase[i], chunk.positions);
+        appendAt(data.texCoords, uvStart + uvBase[i], chunk.texCoords);
+        appendAt(data.normals, normalStart + normalBase[i], chunk.normals);
+        appendAt(data.vertexIndices, vertexIndexStart + vertexIndexBase[i], chunk.vertexIndices);
+        appendAt(data.uvIndices, uvIndexStart + uvIndexBase[i], chunk.uvIndices);
+        appendAt(data.normalIndices, normalIndexStart + normalIndexBase[i], chunk.normalIndices);
+        chunk = OBJData();
+    }, threads);
+}
+
+} // namespace OBJParser
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// 可用的工作线程数
+inline int workerCount() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// 在[0, count)上并行执行fn(i)，最多使用threads个线程（0表示全部），调用线程也参与计算
+template <typename Func>
+void parallelFor(int count, Func&& fn, int threads = 0) {
+    if (threads <= 0) {
+        threads = workerCount();
+    }
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (int i = 0; i < count; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            fn(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+#endif
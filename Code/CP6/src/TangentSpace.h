@@ -0,0 +1,119 @@
+#ifndef TANGENTSPACE_H
+#define TANGENTSPACE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Parallel.h"
+
+// 按MikkTSpace（Mikkelsen，2008）的规则为索引三角形网格生成逐顶点切线：
+// 三角形的切线、副切线由位置与纹理坐标的偏导求出，投影到顶点法线的切平面后按角点的夹角加权累加，
+// Tangent.w为副切线的方向（±1），MikkTSpace的副切线 = w * cross(N, T)；
+// fragment.glsl使用其反方向 -w * cross(N, T)，保持原先的G通道约定（DirectX），
+// 按OpenGL约定烘焙的法线贴图需先翻转G通道。
+// 三角形与顶点两步分别并行，累加按固定顺序进行，结果与线程数无关
+namespace TangentSpace {
+
+// 每个并行任务处理的三角形数与顶点数
+constexpr int CHUNK_SIZE = 4096;
+
+// 与n垂直的任意单位向量，用于没有有效纹理坐标的顶点
+inline glm::vec3 anyPerpendicular(const glm::vec3& n) {
+    glm::vec3 axis = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 t = axis - n * glm::dot(n, axis);
+    float length = glm::length(t);
+    return length > 0.0f ? t / length : glm::vec3(1.0f, 0.0f, 0.0f);
+}
+
+// VertexT需要Position、Normal（单位向量）、TexCoords与Tangent（glm::vec4）成员
+template <typename VertexT>
+void generate(std::vector<VertexT>& vertices, const std::vector<unsigned int>& indices) {
+    size_t vertexCount = vertices.size();
+    size_t triangleCount = indices.size() / 3;
+
+    // 1. 每个三角形的切线与副切线（未归一化）；纹理坐标退化的三角形不参与累加
+    std::vector<glm::vec3> triangleTangents(triangleCount), triangleBitangents(triangleCount);
+    std::vector<char> triangleValid(triangleCount, 0);
+    int triangleChunks = static_cast<int>((triangleCount + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    parallelFor(triangleChunks, [&](int chunk) {
+        size_t end = std::min(triangleCount, size_t(chunk + 1) * CHUNK_SIZE);
+        for (size_t t = size_t(chunk) * CHUNK_SIZE; t < end; t++) {
+            const VertexT& v0 = vertices[indices[t * 3]];
+            const VertexT& v1 = vertices[indices[t * 3 + 1]];
+            const VertexT& v2 = vertices[indices[t * 3 + 2]];
+            glm::vec3 e1 = v1.Position - v0.Position, e2 = v2.Position - v0.Position;
+            glm::vec2 d1 = v1.TexCoords - v0.TexCoords, d2 = v2.TexCoords - v0.TexCoords;
+            float det = d1.x * d2.y - d2.x * d1.y;
+            if (std::fabs(det) > 1e-12f) {
+                // 不除以行列式的绝对值，只保留其符号：大小在投影后归一化，方向决定副切线朝向
+                float sign = det > 0.0f ? 1.0f : -1.0f;
+                triangleTangents[t] = (e1 * d2.y - e2 * d1.y) * sign;
+                triangleBitangents[t] = (e2 * d1.x - e1 * d2.x) * sign;
+                triangleValid[t] = 1;
+            }
+        }
+    });
+
+    // 2. 顶点到相邻角点的邻接表（CSR），角点按三角形顺序排列
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (unsigned int index : indices) {
+        offsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<unsigned int> corners(triangleCount * 3);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        corners[fill[indices[i]]++] = static_cast<unsigned int>(i);
+    }
+
+    // 3. 每个顶点按角点夹角加权累加投影后的切线与副切线，再对法线正交化
+    int vertexChunks = static_cast<int>((vertexCount + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    parallelFor(vertexChunks, [&](int chunk) {
+        size_t end = std::min(vertexCount, size_t(chunk + 1) * CHUNK_SIZE);
+        for (size_t v = size_t(chunk) * CHUNK_SIZE; v < end; v++) {
+            VertexT& vertex = vertices[v];
+            glm::vec3 n = vertex.Normal;
+            glm::vec3 tangent(0.0f), bitangent(0.0f);
+            for (unsigned int c = offsets[v]; c < offsets[v + 1]; c++) {
+                unsigned int corner = corners[c];
+                size_t t = corner / 3;
+                if (!triangleValid[t]) {
+                    continue;
+                }
+                // 角点处两条边的夹角
+                unsigned int k = corner % 3;
+                glm::vec3 p = vertices[indices[t * 3 + k]].Position;
+                glm::vec3 a = vertices[indices[t * 3 + (k + 1) % 3]].Position - p;
+                glm::vec3 b = vertices[indices[t * 3 + (k + 2) % 3]].Position - p;
+                float la = glm::length(a), lb = glm::length(b);
+                if (!(la > 0.0f && lb > 0.0f)) {
+                    continue;
+                }
+                float angle = std::acos(glm::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f));
+
+                glm::vec3 pt = triangleTangents[t] - n * glm::dot(n, triangleTangents[t]);
+                glm::vec3 pb = triangleBitangents[t] - n * glm::dot(n, triangleBitangents[t]);
+                float lt = glm::length(pt), lbt = glm::length(pb);
+                if (lt > 0.0f) {
+                    tangent += pt * (angle / lt);
+                }
+                if (lbt > 0.0f) {
+                    bitangent += pb * (angle / lbt);
+                }
+            }
+
+            tangent -= n * glm::dot(n, tangent);
+            float length = glm::length(tangent);
+            glm::vec3 t = length > 1e-20f && std::isfinite(length) ? tangent / length : anyPerpendicular(n);
+            float handedness = glm::dot(glm::cross(n, t), bitangent) < 0.0f ? -1.0f : 1.0f;
+            vertex.Tangent = glm::vec4(t, handedness);
+        }
+    });
+}
+
+} // namespace TangentSpace
+
+#endif
@@ -0,0 +1,433 @@
+#ifndef TEXTURECONTAINER_H
+#define TEXTURECONTAINER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <glad/glad.h>
+#include "MappedFile.h"
+#include "MeshCache.h"
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// 预烘焙的纹理容器：<源图像>.mips，保存完整的mip链（可选BC1/BC4/BC5块压缩），加载时映射文件后逐级上传，
+// 不再解码PNG/JPG，也不调用glGenerateMipmap。
+// 文件布局：Header（含各级的偏移与大小），随后是按16字节对齐的各级数据；行序与上传给OpenGL的一致（自下而上）
+namespace TextureContainer {
+
+constexpr uint32_t MAGIC = 0x5350494Du; // "MIPS"
+constexpr uint32_t VERSION = 1;
+constexpr int MAX_LEVELS = 16;
+
+enum Format : uint32_t {
+    FORMAT_R8 = 0,
+    FORMAT_RG8,
+    FORMAT_RGB8,
+    FORMAT_RGBA8,
+    // 4x4块压缩：BC1用于彩色贴图，BC4用于单通道贴图，BC5用于法线贴图（只保存XY）
+    FORMAT_BC1,
+    FORMAT_BC4,
+    FORMAT_BC5,
+};
+
+struct Level {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    Level levels[MAX_LEVELS];
+};
+
+// 烘焙时的用途，决定压缩格式
+enum Usage {
+    USAGE_COLOR,
+    USAGE_NORMAL,
+};
+
+inline std::string containerPath(const std::string& sourcePath) {
+    return sourcePath + ".mips";
+}
+
+inline bool isCompressed(uint32_t format) {
+    return format >= FORMAT_BC1;
+}
+
+// 每像素通道数（未压缩格式）或每块字节数（压缩格式）
+inline int channelCount(uint32_t format) {
+    static const int channels[] = {1, 2, 3, 4};
+    return format <= FORMAT_RGBA8 ? channels[format] : 0;
+}
+
+inline uint64_t levelSize(uint32_t format, uint32_t width, uint32_t height) {
+    if (isCompressed(format)) {
+        uint64_t blocks = uint64_t((width + 3) / 4) * ((height + 3) / 4);
+        return blocks * (format == FORMAT_BC5 ? 16 : 8);
+    }
+    return uint64_t(width) * height * channelCount(format);
+}
+
+inline int levelCountFor(int width, int height) {
+    int levels = 1;
+    while ((width > 1 || height > 1) && levels < MAX_LEVELS) {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+// 2x2盒式滤波生成下一级；尺寸为奇数时最后一行/列与前一行/列合并
+inline std::vector<uint8_t> downsample(const uint8_t* source, int width, int height, int channels) {
+    int nextWidth = std::max(1, width / 2);
+    int nextHeight = std::max(1, height / 2);
+    std::vector<uint8_t> result(size_t(nextWidth) * nextHeight * channels);
+    for (int y = 0; y < nextHeight; y++) {
+        int y0 = std::min(y * 2, height - 1);
+        int y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < nextWidth; x++) {
+            int x0 = std::min(x * 2, width - 1);
+            int x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < channels; c++) {
+                int sum = source[(size_t(y0) * width + x0) * channels + c] + source[(size_t(y0) * width + x1) * channels + c] +
+                          source[(size_t(y1) * width + x0) * channels + c] + source[(size_t(y1) * width + x1) * channels + c];
+                result[(size_t(y) * nextWidth + x) * channels + c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+// 取出以(bx, by)块为起点的4x4个像素的一个或多个通道，超出图像的部分重复边缘像素
+inline void fetchBlock(const std::vector<uint8_t>& image, int width, int height, int channels, int bx, int by,
+                       int channel, int count, uint8_t* out) {
+    for (int y = 0; y < 4; y++) {
+        int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++) {
+            int sx = std::min(bx * 4 + x, width - 1);
+            const uint8_t* texel = &image[(size_t(sy) * width + sx) * channels];
+            for (int c = 0; c < count; c++) {
+                out[(y * 4 + x) * count + c] = channel + c < channels ? texel[channel + c] : 0;
+            }
+        }
+    }
+}
+
+// BC4单通道块：端点取最小、最大值，使用8级插值
+inline void encodeBC4(const uint8_t* values, uint8_t* out) {
+    uint8_t high = *std::max_element(values, values + 16);
+    uint8_t low = *std::min_element(values, values + 16);
+    out[0] = high;
+    out[1] = low;
+    uint64_t bits = 0;
+    if (high > low) {
+        int palette[8] = {high, low};
+        for (int i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * high + (i - 1) * low) / 7;
+        }
+        for (int t = 0; t < 16; t++) {
+            int best = 0, bestError = 256;
+            for (int i = 0; i < 8; i++) {
+                int error = std::abs(palette[i] - values[t]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = i;
+                }
+            }
+            bits |= uint64_t(best) << (3 * t);
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+}
+
+inline uint16_t packRGB565(int r, int g, int b) {
+    return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+inline void unpackRGB565(uint16_t c, int* rgb) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// BC1彩色块（不含透明）：端点取内缩的包围盒对角线，方向按各通道与绿色的协方差符号选择
+inline void encodeBC1(const uint8_t* rgb, uint8_t* out) {
+    int low[3] = {255, 255, 255}, high[3] = {0, 0, 0}, mean[3] = {0, 0, 0};
+    for (int t = 0; t < 16; t++) {
+        for (int c = 0; c < 3; c++) {
+            low[c] = std::min(low[c], int(rgb[t * 3 + c]));
+            high[c] = std::max(high[c], int(rgb[t * 3 + c]));
+            mean[c] += rgb[t * 3 + c];
+        }
+    }
+    int covarianceRG = 0, covarianceBG = 0;
+    for (int t = 0; t < 16; t++) {
+        int g = rgb[t * 3 + 1] * 16 - mean[1];
+        covarianceRG += (rgb[t * 3] * 16 - mean[0]) * g;
+        covarianceBG += (rgb[t * 3 + 2] * 16 - mean[2]) * g;
+    }
+    for (int c = 0; c < 3; c++) {
+        int inset = (high[c] - low[c]) / 16;
+        low[c] += inset;
+        high[c] -= inset;
+    }
+    if (covarianceRG < 0) {
+        std::swap(low[0], high[0]);
+    }
+    if (covarianceBG < 0) {
+        std::swap(low[2], high[2]);
+    }
+
+    uint16_t color0 = packRGB565(high[0], high[1], high[2]);
+    uint16_t color1 = packRGB565(low[0], low[1], low[2]);
+    // color0 > color1时为四色模式
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+    uint32_t bits = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int t = 0; t < 16; t++) {
+            int best = 0, bestError = 1 << 30;
+            for (int i = 0; i < 4; i++) {
+                int dr = palette[i][0] - rgb[t * 3], dg = palette[i][1] - rgb[t * 3 + 1], db = palette[i][2] - rgb[t * 3 + 2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    best = i;
+                }
+            }
+            bits |= uint32_t(best) << (2 * t);
+        }
+    }
+    out[0] = static_cast<uint8_t>(color0);
+    out[1] = static_cast<uint8_t>(color0 >> 8);
+    out[2] = static_cast<uint8_t>(color1);
+    out[3] = static_cast<uint8_t>(color1 >> 8);
+    for (int i = 0; i < 4; i++) {
+        out[4 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+}
+
+inline std::vector<uint8_t> compressLevel(const std::vector<uint8_t>& image, int width, int height, int channels,
+                                          uint32_t format) {
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    std::vector<uint8_t> result(levelSize(format, width, height));
+    uint8_t texels[48];
+    uint8_t* out = result.data();
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            if (format == FORMAT_BC1) {
+                fetchBlock(image, width, height, channels, bx, by, 0, 3, texels);
+                // 单通道、双通道图像按灰度处理
+                if (channels < 3) {
+                    for (int t = 0; t < 16; t++) {
+                        texels[t * 3 + 1] = texels[t * 3 + 2] = texels[t * 3];
+                    }
+                }
+                encodeBC1(texels, out);
+                out += 8;
+            } else {
+                int components = format == FORMAT_BC5 ? 2 : 1;
+                for (int c = 0; c < components; c++) {
+                    fetchBlock(image, width, height, channels, bx, by, c, 1, texels);
+                    encodeBC4(texels, out);
+                    out += 8;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// 由解码后的图像（行序自下而上）烘焙容器文件；compress为false时保存未压缩的各级
+inline bool bake(const std::string& path, const MeshCache::SourceKey& key, const uint8_t* pixels, int width,
+                 int height, int channels, Usage usage, bool compress) {
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+        return false;
+    }
+    uint32_t format = static_cast<uint32_t>(channels - 1);
+    if (compress) {
+        format = usage == USAGE_NORMAL && channels >= 2 ? FORMAT_BC5 : channels == 1 ? FORMAT_BC4 : FORMAT_BC1;
+    }
+
+    Header header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.sourceSize = key.size;
+    header.sourceTime = key.time;
+    header.format = format;
+    header.width = width;
+    header.height = height;
+    header.levelCount = levelCountFor(width, height);
+
+    std::vector<std::vector<uint8_t>> levels;
+    std::vector<uint8_t> image(pixels, pixels + size_t(width) * height * channels);
+    uint64_t offset = MeshCache::alignUp(sizeof(Header));
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        levels.push_back(compress ? compressLevel(image, width, height, channels, format) : image);
+        header.levels[level] = {offset, levels.back().size(), uint32_t(width), uint32_t(height)};
+        offset = MeshCache::alignUp(offset + levels.back().size());
+        if (level + 1 < header.levelCount) {
+            image = downsample(image.data(), width, height, channels);
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+        }
+    }
+
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        const char padding[16] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        for (uint32_t level = 0; level < header.levelCount; level++) {
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(padding, static_cast<std::streamsize>(header.levels[level].offset - position));
+            file.write(reinterpret_cast<const char*>(levels[level].data()),
+                       static_cast<std::streamsize>(levels[level].size()));
+        }
+        if (!file) {
+            file.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 映射容器文件并校验；源图像修改过、格式不符或文件损坏时open返回false
+class Reader {
+public:
+    bool open(const std::string& path, const MeshCache::SourceKey& key) {
+        if (!key.valid || !file.open(path) || file.size() < sizeof(Header)) {
+            file.close();
+            return false;
+        }
+        std::memcpy(&head, file.data(), sizeof(Header));
+        bool valid = head.magic == MAGIC && head.version == VERSION && head.sourceSize == key.size &&
+                     head.sourceTime == key.time && head.format <= FORMAT_BC5 && head.width > 0 &&
+                     head.height > 0 && head.levelCount >= 1 && head.levelCount <= MAX_LEVELS;
+        uint32_t width = head.width, height = head.height;
+        for (uint32_t level = 0; valid && level < head.levelCount; level++) {
+            const Level& info = head.levels[level];
+            valid = info.width == width && info.height == height &&
+                    info.size == levelSize(head.format, width, height) && info.offset + info.size <= file.size();
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+        if (!valid) {
+            file.close();
+        }
+        return valid;
+    }
+
+    const Header& header() const { return head; }
+    const uint8_t* levelData(uint32_t level) const {
+        return reinterpret_cast<const uint8_t*>(file.data()) + head.levels[level].offset;
+    }
+
+private:
+    MappedFile file;
+    Header head = {};
+};
+
+inline bool hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension != nullptr && std::strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 当前上下文能否使用该格式（BC1需要S3TC扩展，BC4/BC5为核心功能）
+inline bool isSupported(uint32_t format) {
+    if (format == FORMAT_BC1) {
+        static const bool s3tc = hasExtension("GL_EXT_texture_compression_s3tc");
+        return s3tc;
+    }
+    return true;
+}
+
+// OpenGL内部格式与像素格式
+inline void glFormat(uint32_t format, GLenum& internalFormat, GLenum& pixelFormat) {
+    static const GLenum formats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    switch (format) {
+    case FORMAT_BC1:
+        internalFormat = pixelFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        break;
+    case FORMAT_BC4:
+        internalFormat = pixelFormat = GL_COMPRESSED_RED_RGTC1;
+        break;
+    case FORMAT_BC5:
+        internalFormat = pixelFormat = GL_COMPRESSED_RG_RGTC2;
+        break;
+    default:
+        internalFormat = pixelFormat = formats[format];
+        break;
+    }
+}
+
+// 把全部mip级上传到当前绑定的GL_TEXTURE_2D
+inline void upload(const Reader& reader) {
+    const Header& header = reader.header();
+    GLenum internalFormat, pixelFormat;
+    glFormat(header.format, internalFormat, pixelFormat);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        const Level& info = header.levels[level];
+        if (isCompressed(header.format)) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, info.width, info.height, 0,
+                                   static_cast<GLsizei>(info.size), reader.levelData(level));
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, info.width, info.height, 0, pixelFormat,
+                         GL_UNSIGNED_BYTE, reader.levelData(level));
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.levelCount - 1);
+}
+
+} // namespace TextureContainer
+
+#endif
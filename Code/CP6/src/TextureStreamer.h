@@ -0,0 +1,271 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "TextureContainer.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+
+// 纹理流式上传：后台线程解码（或映射预烘焙容器）并准备好完整的mip链，
+// GL线程每帧在字节预算内经PBO环形缓冲（每次写入前重新分配存储，即orphaning，不等待GPU）用glTexSubImage2D上传。
+// 各纹理从最小的mip级开始上传，每完成一级就把GL_TEXTURE_BASE_LEVEL降到该级，
+// 因此模型立即以低分辨率贴图显示，随后逐渐变清晰；大的mip级按行分段，跨多帧上传
+class TextureStreamer {
+public:
+    // 环形缓冲中有ringSize个PBO，每个segmentBytes字节，也是单次上传的最大字节数；需在GL线程构造
+    explicit TextureStreamer(size_t segmentBytes = 4 << 20, int ringSize = 3)
+        : segment(segmentBytes), ready(std::make_shared<CompletionQueue<Prepared>>()) {
+        buffers.resize(std::max(1, ringSize));
+        glGenBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+        bc1Supported = TextureContainer::isSupported(TextureContainer::FORMAT_BC1);
+    }
+
+    ~TextureStreamer() {
+        glDeleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // 立即为每个路径创建纹理对象并返回路径到纹理ID的映射，相同路径只加载一次；内容由之后的update逐帧上传
+    std::map<std::string, unsigned int> request(const std::vector<std::string>& paths) {
+        std::map<std::string, unsigned int> textures;
+        for (const auto& path : paths) {
+            if (!path.empty() && textures.find(path) == textures.end()) {
+                unsigned int texture;
+                glGenTextures(1, &texture);
+                textures[path] = texture;
+                outstanding++;
+                std::shared_ptr<CompletionQueue<Prepared>> queue = ready;
+                bool allowBC1 = bc1Supported;
+                ThreadPool::shared().submit(
+                    [queue, path, texture, allowBC1]() { queue->push(prepare(path, texture, allowBC1)); });
+            }
+        }
+        return textures;
+    }
+
+    // 每帧在GL线程调用，最多上传budgetBytes字节（至少推进一段，保证进度）
+    void update(size_t budgetBytes) {
+        Prepared item;
+        while (ready->tryPop(item)) {
+            begin(std::move(item));
+        }
+
+        lastFrameBytes = 0;
+        while (!active.empty()) {
+            // 先上传当前所有纹理中最小的一级，所有纹理都先得到低分辨率版本
+            auto next = std::min_element(active.begin(), active.end(), [](const Prepared& a, const Prepared& b) {
+                return a.levels[a.level].size < b.levels[b.level].size;
+            });
+            size_t allowance = budgetBytes > lastFrameBytes ? budgetBytes - lastFrameBytes : 0;
+            if (lastFrameBytes > 0 && allowance < rowBytes(*next)) {
+                break;
+            }
+            size_t bytes = uploadChunk(*next, allowance);
+            if (bytes == 0) {
+                // PBO映射失败，下一帧重试；连续失败过多时放弃该纹理，保留已上传完整的级
+                if (next->mapFailures >= MAX_MAP_FAILURES) {
+                    std::cerr << "纹理上传失败（无法映射PBO）: " << next->path << std::endl;
+                    active.erase(next);
+                    outstanding--;
+                }
+                break;
+            }
+            lastFrameBytes += bytes;
+            if (next->level < 0) {
+                std::cout << "纹理流式加载完成: " << next->path << std::endl;
+                active.erase(next);
+                outstanding--;
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // 尚未完全上传的纹理数
+    int pending() const { return outstanding; }
+
+    // 上一次update上传的字节数
+    size_t lastFrameBytes = 0;
+
+private:
+    struct LevelData {
+        int width;
+        int height;
+        const uint8_t* data;
+        size_t size;
+    };
+
+    // 后台线程准备好的纹理
+    struct Prepared {
+        GLuint texture = 0;
+        std::string path;
+        uint32_t format = 0;
+        std::vector<LevelData> levels;
+        // 数据的所有者：预烘焙容器或解码后的图像及CPU生成的各级
+        Utils::DecodedImage image;
+        std::vector<std::vector<uint8_t>> storage;
+        // 正在上传的级（从最小一级向0递减，<0表示完成）与该级已上传的行数（压缩格式为块行数）
+        int level = -1;
+        int uploadedRows = 0;
+        // 连续映射PBO失败的次数
+        int mapFailures = 0;
+    };
+
+    // 同一纹理连续映射失败的次数达到该值时放弃
+    static constexpr int MAX_MAP_FAILURES = 60;
+
+    size_t segment;
+    std::vector<GLuint> buffers;
+    size_t nextBuffer = 0;
+    bool bc1Supported = false;
+    std::shared_ptr<CompletionQueue<Prepared>> ready;
+    std::vector<Prepared> active;
+    int outstanding = 0;
+
+    static Prepared prepare(const std::string& path, GLuint texture, bool allowBC1) {
+        Prepared item;
+        item.texture = texture;
+        item.path = path;
+        item.image = Utils::decodeImage(path);
+        if (item.image.baked && item.image.baked->header().format == TextureContainer::FORMAT_BC1 && !allowBC1) {
+            item.image = Utils::decodeSource(path);
+        }
+        if (item.image.baked) {
+            const TextureContainer::Header& header = item.image.baked->header();
+            item.format = header.format;
+            for (uint32_t level = 0; level < header.levelCount; level++) {
+                const TextureContainer::Level& info = header.levels[level];
+                item.levels.push_back({int(info.width), int(info.height), item.image.baked->levelData(level),
+                                       size_t(info.size)});
+            }
+        } else if (item.image.pixels && item.image.channels >= 1 && item.image.channels <= 4) {
+            // 未烘焙的图像在后台线程生成mip链
+            int width = item.image.width, height = item.image.height, channels = item.image.channels;
+            item.format = static_cast<uint32_t>(channels - 1);
+            int levelCount = TextureContainer::levelCountFor(width, height);
+            item.storage.reserve(levelCount);
+            const uint8_t* data = item.image.pixels.get();
+            for (int level = 0; level < levelCount; level++) {
+                item.levels.push_back({width, height, data, size_t(width) * height * channels});
+                if (level + 1 < levelCount) {
+                    item.storage.push_back(TextureContainer::downsample(data, width, height, channels));
+                    data = item.storage.back().data();
+                    width = std::max(1, width / 2);
+                    height = std::max(1, height / 2);
+                }
+            }
+        }
+        return item;
+    }
+
+    void begin(Prepared item) {
+        glBindTexture(GL_TEXTURE_2D, item.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        if (item.levels.empty()) {
+            std::cerr << "纹理加载失败: " << item.path << std::endl;
+            outstanding--;
+            return;
+        }
+        // 一次分配所有级的存储（内容为空），之后只写入数据，避免逐级加入更大的级时驱动重新分配并复制已上传的级
+        bool compressed = TextureContainer::isCompressed(item.format);
+        GLenum internalFormat, pixelFormat;
+        TextureContainer::glFormat(item.format, internalFormat, pixelFormat);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (size_t level = 0; level < item.levels.size(); level++) {
+            const LevelData& info = item.levels[level];
+            if (compressed) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, info.width,
+                                       info.height, 0, static_cast<GLsizei>(info.size), nullptr);
+            } else {
+                glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, info.width, info.height, 0,
+                             pixelFormat, GL_UNSIGNED_BYTE, nullptr);
+            }
+        }
+        int last = static_cast<int>(item.levels.size()) - 1;
+        // 在第一级上传完成前纹理不完整，采样结果为黑色
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, last);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, last);
+        item.level = last;
+        item.uploadedRows = 0;
+        active.push_back(std::move(item));
+    }
+
+    // 当前级的行数，压缩格式按4像素高的块行计
+    static int rowCount(const Prepared& item) {
+        int height = item.levels[item.level].height;
+        return TextureContainer::isCompressed(item.format) ? (height + 3) / 4 : height;
+    }
+
+    static size_t rowBytes(const Prepared& item) { return item.levels[item.level].size / rowCount(item); }
+
+    // 上传item当前级的下一段，最多allowance字节（至少一行），返回上传的字节数；映射PBO失败时不改变进度，返回0
+    size_t uploadChunk(Prepared& item, size_t allowance) {
+        const LevelData& level = item.levels[item.level];
+        bool compressed = TextureContainer::isCompressed(item.format);
+        GLenum internalFormat, pixelFormat;
+        TextureContainer::glFormat(item.format, internalFormat, pixelFormat);
+        int rows = rowCount(item);
+        size_t bytesPerRow = rowBytes(item);
+
+        size_t limit = std::min(segment, std::max(allowance, bytesPerRow));
+        int count = static_cast<int>(
+            std::min<size_t>(rows - item.uploadedRows, std::max<size_t>(1, limit / bytesPerRow)));
+        size_t bytes = bytesPerRow * count;
+        const uint8_t* source = level.data + bytesPerRow * item.uploadedRows;
+
+        glBindTexture(GL_TEXTURE_2D, item.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        // 写入环形缓冲中的下一个PBO；先重新分配存储，GPU仍在读取的旧存储由驱动保留
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[nextBuffer]);
+        nextBuffer = (nextBuffer + 1) % buffers.size();
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(std::max(segment, bytes)), nullptr, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes),
+                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped == nullptr) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            item.mapFailures++;
+            return 0;
+        }
+        std::memcpy(mapped, source, bytes);
+        // 映射期间存储被破坏（如显存丢失）时内容未定义，同样按失败处理
+        if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            item.mapFailures++;
+            return 0;
+        }
+        item.mapFailures = 0;
+        if (compressed) {
+            int y = item.uploadedRows * 4;
+            int height = std::min(count * 4, level.height - y);
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, item.level, 0, y, level.width, height, internalFormat,
+                                      static_cast<GLsizei>(bytes), nullptr);
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, item.level, 0, item.uploadedRows, level.width, count, pixelFormat,
+                            GL_UNSIGNED_BYTE, nullptr);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        item.uploadedRows += count;
+        if (item.uploadedRows >= rows) {
+            // 该级完整后即可用于采样
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, item.level);
+            item.level--;
+            item.uploadedRows = 0;
+        }
+        return bytes;
+    }
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Parallel.h"
+
+// 固定数量工作线程的任务池，任务按提交顺序取出执行；析构时执行完已提交的任务再退出
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads = 0) {
+        if (threads <= 0) {
+            threads = workerCount();
+        }
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    // 程序共用的任务池（纹理解码等后台工作）
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void run() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+// 工作线程把结果放入队列，另一个线程（通常是GL线程）按完成顺序取出
+template <typename T>
+class CompletionQueue {
+public:
+    void push(T value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            items.push_back(std::move(value));
+        }
+        ready.notify_one();
+    }
+
+    // 阻塞直到有结果
+    T pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this]() { return !items.empty(); });
+        T value = std::move(items.front());
+        items.pop_front();
+        return value;
+    }
+
+    // 没有结果时立即返回false
+    bool tryPop(T& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty()) {
+            return false;
+        }
+        value = std::move(items.front());
+        items.pop_front();
+        return true;
+    }
+
+private:
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable ready;
+};
+
+#endif
@@ -7,10 +7,13 @@
 #include <glm/glm.hpp>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "TextureContainer.h"
+
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../../thirdparty/stb/stb_image.h"
@@ -109,51 +112,45 @@ inline unsigned int createShaderProgram(const std::string &vertexPath, const std
     return program;
 }
 
-// 加载纹理
-inline unsigned int loadTexture(const std::string &path)
+// 解码后的图像；有最新的预烘焙容器（<路径>.mips）时baked指向映射的容器，pixels为空
+struct DecodedImage
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::unique_ptr<unsigned char, void (*)(void *)> pixels{nullptr, stbi_image_free};
+    std::unique_ptr<TextureContainer::Reader> baked;
+};
 
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true); // OpenGL纹理坐标系统
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrChannels == 1)
-            format = GL_RED;
-        else if (nrChannels == 3)
-            format = GL_RGB;
-        else if (nrChannels == 4)
-            format = GL_RGBA;
-        else
-            format = GL_RGB;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-        std::cout << "纹理加载成功: " << path << " (" << width << "x" << height << ", " << nrChannels << " channels)"
-                  << std::endl;
-    }
-    else
+// 只解码图像文件本身，不查找容器
+inline DecodedImage decodeSource(const std::string &path)
+{
+    DecodedImage image;
+    image.path = path;
+    stbi_set_flip_vertically_on_load_thread(true); // OpenGL纹理坐标系统
+    image.pixels.reset(stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0));
+    return image;
+}
+
+// 解码图像文件，不调用OpenGL，可在工作线程中执行；优先使用预烘焙的容器
+inline DecodedImage decodeImage(const std::string &path)
+{
+    auto baked = std::make_unique<TextureContainer::Reader>();
+    if (baked->open(TextureContainer::containerPath(path), MeshCache::sourceKey(path)))
     {
-        std::cerr << "纹理加载失败: " << path << std::endl;
-        stbi_image_free(data);
+        DecodedImage image;
+        image.path = path;
+        image.width = baked->header().width;
+        image.height = baked->header().height;
+        image.baked = std::move(baked);
+        return image;
     }
-
-    return textureID;
+    return decodeSource(path);
 }
 
-// 读取MTL材质文件
-inline std::map<std::string, PBRMaterial> loadMTL(const std::string &mtlPath, const std::string &baseDir = "")
+// 解析MTL材质文件，只读取参数与贴图路径，不加载纹理
+inline std::map<std::string, PBRMaterial> parseMTL(const std::string &mtlPath, const std::string &baseDir = "")
 {
     std::map<std::string, PBRMaterial> materials;
     std::ifstream file(mtlPath);
@@ -269,34 +266,47 @@ inline std::map<std::string, PBRMaterial> loadMTL(const std::string &mtlPath, co
     }
 
     file.close();
+    return materials;
+}
+
+// 材质引用的全部贴图路径（可能重复）
+inline std::vector<std::string> texturePaths(const std::map<std::string, PBRMaterial> &materials)
+{
+    std::vector<std::string> paths;
+    for (const auto &[name, mat] : materials)
+    {
+        paths.insert(paths.end(), {mat.albedoPath, mat.metallicPath, mat.roughnessPath, mat.normalPath, mat.aoPath});
+    }
+    return paths;
+}
 
-    // 加载所有纹理
+// 按路径把纹理ID填入材质
+inline void assignTextures(std::map<std::string, PBRMaterial> &materials,
+                           std::map<std::string, unsigned int> &textures)
+{
     for (auto &[name, mat] : materials)
     {
         if (!mat.albedoPath.empty())
         {
-            mat.albedoMap = loadTexture(mat.albedoPath);
+            mat.albedoMap = textures[mat.albedoPath];
         }
         if (!mat.metallicPath.empty())
         {
-            mat.metallicMap = loadTexture(mat.metallicPath);
+            mat.metallicMap = textures[mat.metallicPath];
         }
         if (!mat.roughnessPath.empty())
         {
-            mat.roughnessMap = loadTexture(mat.roughnessPath);
+            mat.roughnessMap = textures[mat.roughnessPath];
         }
         if (!mat.normalPath.empty())
         {
-            mat.normalMap = loadTexture(mat.normalPath);
+            mat.normalMap = textures[mat.normalPath];
         }
         if (!mat.aoPath.empty())
         {
-            mat.aoMap = loadTexture(mat.aoPath);
+            mat.aoMap = textures[mat.aoPath];
         }
     }
-
-    std::cout << "MTL文件加载成功: " << materials.size() << " 个材质" << std::endl;
-    return materials;
 }
 
 // 创建默认PBR材质
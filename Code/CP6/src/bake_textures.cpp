@@ -0,0 +1,95 @@
+// 纹理烘焙工具：为MTL引用的贴图生成预烘焙的mip链容器（<贴图>.mips），查看器加载时直接上传
+// 用法：BakeTextures [--bc] <模型目录或.mtl文件>...
+//   --bc  使用块压缩（彩色贴图BC1，单通道贴图BC4，法线贴图BC5）
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Parallel.h"
+#include "TextureContainer.h"
+#include "Utils.h"
+
+int main(int argc, char **argv)
+{
+    bool compress = false;
+    std::vector<std::string> mtlFiles;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--bc")
+        {
+            compress = true;
+        }
+        else if (argument.size() > 4 && argument.compare(argument.size() - 4, 4, ".mtl") == 0)
+        {
+            mtlFiles.push_back(argument);
+        }
+        else
+        {
+            std::vector<std::string> found = Utils::findFilesInDirectory(argument, ".mtl");
+            mtlFiles.insert(mtlFiles.end(), found.begin(), found.end());
+        }
+    }
+    if (mtlFiles.empty())
+    {
+        std::cerr << "用法: BakeTextures [--bc] <模型目录或.mtl文件>..." << std::endl;
+        return 1;
+    }
+
+    // 收集所有贴图，同一贴图被用作法线贴图时按法线贴图烘焙
+    std::map<std::string, TextureContainer::Usage> textures;
+    for (const auto &mtlFile : mtlFiles)
+    {
+        std::string directory = std::filesystem::path(mtlFile).parent_path().string();
+        for (const auto &[name, material] : Utils::parseMTL(mtlFile, directory))
+        {
+            for (const std::string *path :
+                 {&material.albedoPath, &material.metallicPath, &material.roughnessPath, &material.aoPath})
+            {
+                if (!path->empty())
+                {
+                    textures.emplace(*path, TextureContainer::USAGE_COLOR);
+                }
+            }
+            if (!material.normalPath.empty())
+            {
+                textures[material.normalPath] = TextureContainer::USAGE_NORMAL;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, TextureContainer::Usage>> jobs(textures.begin(), textures.end());
+    std::vector<std::string> messages(jobs.size());
+    std::vector<char> succeeded(jobs.size(), 0);
+    auto start = std::chrono::steady_clock::now();
+    parallelFor(static_cast<int>(jobs.size()), [&](int i) {
+        const std::string &path = jobs[i].first;
+        Utils::DecodedImage image = Utils::decodeSource(path);
+        if (!image.pixels)
+        {
+            messages[i] = "无法读取: " + path;
+            return;
+        }
+        std::string output = TextureContainer::containerPath(path);
+        if (!TextureContainer::bake(output, MeshCache::sourceKey(path), image.pixels.get(), image.width, image.height,
+                                    image.channels, jobs[i].second, compress))
+        {
+            messages[i] = "写入失败: " + output;
+            return;
+        }
+        succeeded[i] = 1;
+        messages[i] = "已烘焙: " + output + " (" + std::to_string(std::filesystem::file_size(output)) + " 字节)";
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failures = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        (succeeded[i] ? std::cout : std::cerr) << messages[i] << std::endl;
+        failures += succeeded[i] ? 0 : 1;
+    }
+    std::cout << "共 " << jobs.size() << " 张贴图，失败 " << failures << " 张，用时 " << seconds << " 秒" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
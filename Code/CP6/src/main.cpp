@@ -18,9 +18,12 @@
 #include <glm/gtc/type_ptr.hpp>
 
 // 其他头文件
+#include "AsyncModelLoader.h"
 #include "Camera.h"
 #include "Light.h"
+#include "MaterialBatch.h"
 #include "OBJLoader.h"
+#include "TextureStreamer.h"
 #include "Utils.h"
 
 // 函数声明
@@ -53,9 +56,6 @@ bool lightAnimation = false; // 光源动画开关
 float modelScale = 1.0f;
 glm::vec3 modelRotation(0.0f);
 
-// PBR材质参数
-Utils::PBRMaterial pbrMaterial;
-
 // 时间差
 GLfloat deltaTime = 0.0f; // 当前帧与上一帧的时间差
 GLfloat lastFrame = 0.0f; // 上一帧的时间
@@ -125,32 +125,16 @@ int main()
         return -1;
     }
 
-    // 加载OBJ模型
+    // 后台加载模型与材质，窗口立即进入渲染循环；加载期间显示包围盒代理与进度，
+    // 贴图在后台解码，之后每帧按预算流式上传，先显示低分辨率的mip级
     OBJLoader carModel;
-    if (!carModel.loadOBJ(modelFiles.objPath))
-    {
-        std::cerr << "Failed to load car model: " << modelFiles.objPath << std::endl;
-        return -1;
-    }
+    TextureStreamer textureStreamer;
+    AsyncModelLoader modelLoader(carModel, textureStreamer);
+    modelLoader.start(modelFiles);
 
-    // 从MTL文件加载PBR材质
-    std::map<std::string, Utils::PBRMaterial> materials;
-    if (!modelFiles.mtlPath.empty())
-    {
-        materials = Utils::loadMTL(modelFiles.mtlPath, modelFiles.directory);
-    }
-
-    // 使用第一个材质或创建默认材质
-    if (!materials.empty())
-    {
-        pbrMaterial = materials.begin()->second;
-        std::cout << "Using material: " << materials.begin()->first << std::endl;
-    }
-    else
-    {
-        pbrMaterial = Utils::createDefaultPBRMaterial();
-        std::cout << "Using default PBR material" << std::endl;
-    }
+    // 按材质分段绘制，绘制顺序按纹理状态排序；模型加载完成后再build
+    MaterialBatch carBatch;
+    MaterialBatch::bindSamplers(shaderProgram);
 
     // 光源立方体顶点（用于可视化）
     GLfloat lightVertices[] = {
@@ -293,6 +277,16 @@ int main()
         glfwPollEvents();
         do_movement();
 
+        // 取出后台加载的结果；网格与材质都就绪后建立绘制批次
+        if (modelLoader.update())
+        {
+            carBatch.build(carModel, modelLoader.materials, modelLoader.fallbackMaterial);
+            std::cout << "Submeshes: " << carModel.subMeshes.size() << std::endl;
+        }
+
+        // 每帧最多上传8MB贴图数据，避免加载期间卡顿
+        textureStreamer.update(8 << 20);
+
         // 开始Dear ImGui帧
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -338,8 +332,26 @@ int main()
 
         // 显示FPS和模型信息
         ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
-        ImGui::Text("Vertices: %d", (int)carModel.vertices.size());
-        ImGui::Text("Triangles: %d", (int)carModel.indices.size() / 3);
+        if (modelLoader.ready)
+        {
+            ImGui::Text("Vertices: %d", (int)carModel.vertexCount);
+            ImGui::Text("Triangles: %d", (int)carModel.indexCount / 3);
+            ImGui::Text("ACMR: %.3f -> %.3f", carModel.acmrBefore, carModel.acmrAfter);
+            ImGui::Text("Submeshes: %d, Draw Calls: %d", (int)carModel.subMeshes.size(), carBatch.drawCalls);
+            ImGui::Text("Material Changes: %d, Texture Binds: %d", carBatch.materialChanges, carBatch.textureBinds);
+        }
+        else if (modelLoader.failed)
+        {
+            ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.35f, 1.0f), "%s", modelLoader.error.c_str());
+        }
+        else
+        {
+            // 加载期间模型的字段由工作线程写入，只显示进度
+            ImGui::Text("Loading Model:");
+            ImGui::ProgressBar(modelLoader.progress(), ImVec2(-1.0f, 0.0f), modelLoader.stageName());
+        }
+        ImGui::Text("Streaming Textures: %d, Uploaded: %.2f MB", textureStreamer.pending(),
+                    textureStreamer.lastFrameBytes / (1024.0 * 1024.0));
 
         ImGui::End();
 
@@ -374,90 +386,6 @@ int main()
             glUniform3f(lightColorLoc, lightColors[i].x, lightColors[i].y, lightColors[i].z);
         }
 
-        // 设置PBR材质属性
-        GLint albedoLoc = glGetUniformLocation(shaderProgram, "albedo");
-        GLint metallicLoc = glGetUniformLocation(shaderProgram, "metallic");
-        GLint roughnessLoc = glGetUniformLocation(shaderProgram, "roughness");
-        GLint aoLoc = glGetUniformLocation(shaderProgram, "ao");
-
-        glUniform3f(albedoLoc, pbrMaterial.albedo.x, pbrMaterial.albedo.y, pbrMaterial.albedo.z);
-        glUniform1f(metallicLoc, pbrMaterial.metallic);
-        glUniform1f(roughnessLoc, pbrMaterial.roughness);
-        glUniform1f(aoLoc, pbrMaterial.ao);
-
-        // 绑定PBR纹理
-        int textureUnit = 0;
-
-        // 反射率贴图
-        if (pbrMaterial.albedoMap != 0)
-        {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pbrMaterial.albedoMap);
-            glUniform1i(glGetUniformLocation(shaderProgram, "albedoMap"), textureUnit);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useAlbedoMap"), 1);
-            textureUnit++;
-        }
-        else
-        {
-            glUniform1i(glGetUniformLocation(shaderProgram, "useAlbedoMap"), 0);
-        }
-
-        // 金属度贴图
-        if (pbrMaterial.metallicMap != 0)
-        {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pbrMaterial.metallicMap);
-            glUniform1i(glGetUniformLocation(shaderProgram, "metallicMap"), textureUnit);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useMetallicMap"), 1);
-            textureUnit++;
-        }
-        else
-        {
-            glUniform1i(glGetUniformLocation(shaderProgram, "useMetallicMap"), 0);
-        }
-
-        // 粗糙度贴图
-        if (pbrMaterial.roughnessMap != 0)
-        {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pbrMaterial.roughnessMap);
-            glUniform1i(glGetUniformLocation(shaderProgram, "roughnessMap"), textureUnit);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useRoughnessMap"), 1);
-            textureUnit++;
-        }
-        else
-        {
-            glUniform1i(glGetUniformLocation(shaderProgram, "useRoughnessMap"), 0);
-        }
-
-        // 法线贴图
-        if (pbrMaterial.normalMap != 0)
-        {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pbrMaterial.normalMap);
-            glUniform1i(glGetUniformLocation(shaderProgram, "normalMap"), textureUnit);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useNormalMap"), 1);
-            textureUnit++;
-        }
-        else
-        {
-            glUniform1i(glGetUniformLocation(shaderProgram, "useNormalMap"), 0);
-        }
-
-        // 环境遮蔽贴图
-        if (pbrMaterial.aoMap != 0)
-        {
-            glActiveTexture(GL_TEXTURE0 + textureUnit);
-            glBindTexture(GL_TEXTURE_2D, pbrMaterial.aoMap);
-            glUniform1i(glGetUniformLocation(shaderProgram, "aoMap"), textureUnit);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useAOMap"), 1);
-            textureUnit++;
-        }
-        else
-        {
-            glUniform1i(glGetUniformLocation(shaderProgram, "useAOMap"), 0);
-        }
-
         // 创建相机变换矩阵
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 projection =
@@ -479,8 +407,12 @@ int main()
         model = glm::rotate(model, glm::radians(modelRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::rotate(model, glm::radians(modelRotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
         glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-
-        carModel.draw();
+        if (modelLoader.ready)
+        {
+            carModel.setVertexFormatUniforms(shaderProgram);
+            carBatch.draw(shaderProgram, carModel);
+        }
+        glm::mat4 carTransform = model;
 
         // 同时绘制灯光对象（光源立方体）
         glUseProgram(lightShaderProgram);
@@ -507,6 +439,22 @@ int main()
             glBindVertexArray(0);
         }
 
+        // 模型加载完成前用线框绘制包围盒代理（光源立方体边长0.2，缩放到包围盒大小）；加载失败后不再绘制
+        if (!modelLoader.ready && !modelLoader.failed && modelLoader.hasBounds)
+        {
+            glm::vec3 center = (modelLoader.boundsMin + modelLoader.boundsMax) * 0.5f;
+            glm::vec3 extent = glm::max(modelLoader.boundsMax - modelLoader.boundsMin, glm::vec3(1e-4f));
+            model = glm::translate(carTransform, center);
+            model = glm::scale(model, extent / 0.2f);
+            glUniformMatrix4fv(lightModelLoc, 1, GL_FALSE, glm::value_ptr(model));
+
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            glBindVertexArray(lightVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glBindVertexArray(0);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        }
+
         // 渲染ImGui
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -4,6 +4,7 @@ out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 WorldPos;
 in vec3 Normal;
+in vec4 Tangent;
 
 // PBR材质参数
 uniform vec3 albedo;
@@ -38,17 +39,14 @@ vec3 getNormalFromMap()
     if (!useNormalMap)
         return normalize(Normal);
 
-    vec3 tangentNormal = texture(normalMap, TexCoords).xyz * 2.0 - 1.0;
+    // 只用XY分量重建Z，未压缩的RGB法线贴图与BC5（双通道）压缩的法线贴图都适用
+    vec2 tangentXY = texture(normalMap, TexCoords).xy * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(tangentXY, sqrt(max(1.0 - dot(tangentXY, tangentXY), 0.0)));
 
-    vec3 Q1 = dFdx(WorldPos);
-    vec3 Q2 = dFdy(WorldPos);
-    vec2 st1 = dFdx(TexCoords);
-    vec2 st2 = dFdy(TexCoords);
-
-    vec3 N = normalize(Normal);
-    vec3 T = normalize(Q1 * st2.t - Q2 * st1.t);
-    vec3 B = -normalize(cross(N, T));
-    mat3 TBN = mat3(T, B, N);
+    // 插值后的逐顶点切线空间（MikkTSpace约定：不在像素上归一化或正交化T、N），
+    // 副切线取负，与原先按屏幕空间导数求TBN时的法线贴图G通道方向一致
+    vec3 B = -Tangent.w * cross(Normal, Tangent.xyz);
+    mat3 TBN = mat3(Tangent.xyz, B, Normal);
 
     return normalize(TBN * tangentNormal);
 }
@@ -1,21 +1,44 @@
 #version 330 core
-layout(location = 0) in vec3 position;
+layout(location = 0) in vec4 position;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec2 texCoords;
+layout(location = 3) in vec4 tangent;
 
 out vec3 WorldPos;
 out vec3 Normal;
 out vec2 TexCoords;
+out vec4 Tangent;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// 紧凑顶点格式：位置为包围盒内的归一化值（w为副切线方向，0或1），法线与切线为八面体映射的两个分量
+uniform vec3 positionOffset = vec3(0.0);
+uniform vec3 positionScale = vec3(1.0);
+uniform bool packedNormal = false;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main()
 {
+    vec3 localPos = positionOffset + position.xyz * positionScale;
+    vec3 localNormal = packedNormal ? octDecode(clamp(normal.xy, -1.0, 1.0)) : normal;
+    vec3 localTangent = packedNormal ? octDecode(clamp(tangent.xy, -1.0, 1.0)) : tangent.xyz;
+    float handedness = packedNormal ? position.w * 2.0 - 1.0 : tangent.w;
+
     TexCoords = texCoords;
-    WorldPos = vec3(model * vec4(position, 1.0));
-    Normal = mat3(transpose(inverse(model))) * normal;
+    WorldPos = vec3(model * vec4(localPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * localNormal;
+    // 切线随表面变换，用模型矩阵而不是法线矩阵
+    Tangent = vec4(mat3(model) * localTangent, handedness);
 
     gl_Position = projection * view * vec4(WorldPos, 1.0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,511 @@
+#include "batch.hpp"
+#include "deltalog.hpp"
+#include "meshstock.hpp"
+#include "parallel.hpp"
+#include "stlexport.hpp"
+#include "stockstats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+// 作业列表文件为逐行的文本，#之后为注释；第一个job之前的设置作为所有作业的默认值：
+//   job <name>                                  开始一个作业
+//   stock <length> <width> <precision> [float|fixed32|fixed16]
+//   depth <top> <bottom>                        初始顶面与底面高度（毫米）
+//   mesh <path>                                 用STL/OBJ网格作为毛坯
+//   cutter <ball|flat|bullnose> <radius> [corner] [shank]
+//   start <x> <y> <z>                           刀尖起点（网格坐标）
+//   feed <mm/min>
+//   move <dx> <dy> <dz> <steps> [feed] [ax ay az]
+//   program <path>                              从另一个文件读取move行
+//   export <path>                               仿真结束后导出STL
+//   log <path> [interval]                       写增量日志，默认每0.1秒仿真时间一帧
+//   end                                         结束当前作业
+// 相对路径相对于作业列表文件所在目录
+
+namespace
+{
+    std::string resolvePath(const std::filesystem::path &base, const std::string &path)
+    {
+        std::filesystem::path p(path);
+        return p.is_absolute() ? path : (base / p).string();
+    }
+
+    bool parseMove(std::istringstream &line, std::vector<Toolpath> &program)
+    {
+        Toolpath path;
+        if (!(line >> path.direction.x >> path.direction.y >> path.direction.z >> path.length))
+        {
+            return false;
+        }
+        float feed;
+        if (line >> feed)
+        {
+            path.feed = feed;
+            glm::vec3 axis;
+            if (line >> axis.x >> axis.y >> axis.z)
+            {
+                path.axis = axis;
+            }
+        }
+        program.push_back(path);
+        return true;
+    }
+
+    bool loadProgram(const std::string &path, std::vector<Toolpath> &program, std::string &error)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            error = "cannot open program " + path;
+            return false;
+        }
+        std::string text;
+        int number = 0;
+        while (std::getline(file, text))
+        {
+            number++;
+            text = text.substr(0, text.find('#'));
+            std::istringstream line(text);
+            std::string keyword;
+            if (!(line >> keyword))
+            {
+                continue;
+            }
+            if (keyword != "move" || !parseMove(line, program))
+            {
+                error = path + ":" + std::to_string(number) + ": expected a move";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+}
+
+bool loadBatchJobs(const std::string &path, std::vector<BatchJob> &jobs, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::filesystem::path base = std::filesystem::path(path).parent_path();
+    BatchJob defaults;
+    BatchJob current;
+    bool inJob = false;
+    std::string text;
+    int number = 0;
+    while (std::getline(file, text))
+    {
+        number++;
+        text = text.substr(0, text.find('#'));
+        std::istringstream line(text);
+        std::string keyword;
+        if (!(line >> keyword))
+        {
+            continue;
+        }
+        BatchJob &job = inJob ? current : defaults;
+        bool ok = true;
+        if (keyword == "job")
+        {
+            ok = !inJob && bool(line >> current.name);
+            std::string name = current.name;
+            current = defaults;
+            current.name = name;
+            inJob = true;
+        }
+        else if (keyword == "end")
+        {
+            ok = inJob;
+            jobs.push_back(current);
+            inJob = false;
+        }
+        else if (keyword == "stock")
+        {
+            ok = bool(line >> job.length >> job.width >> job.precision) && job.length > 1 && job.width > 1 && job.precision > 0.0f;
+            std::string format;
+            if (ok && line >> format)
+            {
+                if (format == "float")
+                    job.format = HeightFormat::Float;
+                else if (format == "fixed32")
+                    job.format = HeightFormat::Fixed32;
+                else if (format == "fixed16")
+                    job.format = HeightFormat::Fixed16;
+                else
+                    ok = false;
+            }
+        }
+        else if (keyword == "depth")
+        {
+            ok = bool(line >> job.top >> job.bottom) && job.bottom < job.top;
+        }
+        else if (keyword == "mesh")
+        {
+            ok = bool(line >> job.meshPath);
+            job.meshPath = resolvePath(base, job.meshPath);
+        }
+        else if (keyword == "cutter")
+        {
+            std::string shape;
+            ok = bool(line >> shape >> job.radius) && job.radius > 0.0f;
+            if (shape == "ball")
+                job.shape = CutterShape::Ball;
+            else if (shape == "flat")
+                job.shape = CutterShape::Flat;
+            else if (shape == "bullnose")
+                job.shape = CutterShape::BullNose;
+            else
+                ok = false;
+            float value;
+            if (line >> value)
+            {
+                job.cornerRadius = value;
+                if (line >> value)
+                {
+                    job.shankLength = value;
+                }
+            }
+        }
+        else if (keyword == "start")
+        {
+            ok = bool(line >> job.start.x >> job.start.y >> job.start.z);
+        }
+        else if (keyword == "feed")
+        {
+            ok = bool(line >> job.feed) && job.feed > 0.0f;
+        }
+        else if (keyword == "move")
+        {
+            ok = parseMove(line, job.program);
+        }
+        else if (keyword == "program")
+        {
+            std::string program;
+            ok = bool(line >> program);
+            if (ok && !loadProgram(resolvePath(base, program), job.program, error))
+            {
+                return false;
+            }
+        }
+        else if (keyword == "export")
+        {
+            ok = bool(line >> job.exportPath);
+            job.exportPath = resolvePath(base, job.exportPath);
+        }
+        else if (keyword == "log")
+        {
+            ok = bool(line >> job.logPath);
+            job.logPath = resolvePath(base, job.logPath);
+            double interval;
+            if (ok && line >> interval)
+            {
+                ok = interval > 0.0;
+                job.logInterval = interval;
+            }
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            error = path + ":" + std::to_string(number) + ": invalid '" + keyword + "' line";
+            return false;
+        }
+    }
+    if (inJob)
+    {
+        error = path + ": job '" + current.name + "' is missing 'end'";
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const Cutter> CutterCache::get(const BatchJob &job, float heightUnit)
+{
+    Key key(int(job.shape), job.radius, job.cornerRadius, job.shankLength, job.precision, heightUnit);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = cutters.find(key);
+    if (found != cutters.end())
+    {
+        return found->second;
+    }
+    // 球心位于刀具采样网格的中心，高度比刀位高一个半径，因此刀位的y即为刀尖高度
+    auto cutter = std::make_shared<Cutter>(job.radius, job.precision, job.radius, job.radius, job.radius, glm::vec3(0.0f));
+    cutter->shape = job.shape;
+    cutter->cornerRadius = job.cornerRadius;
+    cutter->shankLength = job.shankLength;
+    cutter->samplingBall();
+    cutter->quantizeProfile(heightUnit);
+    cutters[key] = cutter;
+    return cutter;
+}
+
+size_t CutterCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cutters.size();
+}
+
+long long BatchRunner::estimateMemory(const BatchJob &job)
+{
+    // 构造WorkPiece时浮点深度与格式转换的临时数组同时存在，另有体积统计保存的初始深度
+    long long cells = (long long)job.length * job.width;
+    long long bytes = cells * (job.format == HeightFormat::Fixed16 ? 2 : 4) + cells * 8 + cells * 4;
+    if (!job.meshPath.empty())
+    {
+        std::error_code error;
+        auto size = std::filesystem::file_size(job.meshPath, error);
+        // 读入的三角形与分桶索引
+        bytes += error ? 0 : (long long)size * 2;
+    }
+    return bytes;
+}
+
+double BatchRunner::estimateWork(const BatchJob &job)
+{
+    double footprint = double(2 * int(job.radius) + 1) * (2 * int(job.radius) + 1);
+    double work = double(job.length) * job.width;
+    for (const Toolpath &path : job.program)
+    {
+        // 倾斜刀轴或非球头刀逐点求交，代价约为轮廓查表的数十倍
+        bool profile = job.shape == CutterShape::Ball && path.axis.x == 0.0f && path.axis.z == 0.0f;
+        work += double(std::max(path.length, 0)) * footprint * (profile ? 1.0 : 50.0);
+    }
+    return work;
+}
+
+BatchResult BatchRunner::runJob(const BatchJob &job)
+{
+    using Clock = std::chrono::steady_clock;
+    auto begin = Clock::now();
+    BatchResult result;
+    result.name = job.name;
+    result.memoryBytes = estimateMemory(job);
+    try
+    {
+        WorkPiece workpiece(job.length, job.width, job.precision, job.format);
+        if (!job.meshPath.empty())
+        {
+            TriangleMesh mesh;
+            if (!loadTriangleMesh(job.meshPath, mesh))
+            {
+                result.status = "failed";
+                result.message = "cannot load mesh " + job.meshPath;
+                return result;
+            }
+            glm::vec3 offset = fitMeshOffset(mesh, workpiece) + glm::vec3(0.0f, job.top, 0.0f);
+            initWorkpieceFromMesh(workpiece, mesh, offset, job.bottom);
+        }
+        else if (job.top != 0.0f)
+        {
+            for (int x = 0; x < job.length; x++)
+            {
+                for (int z = 0; z < job.width; z++)
+                {
+                    workpiece.setDepth(x, z, job.top);
+                }
+            }
+        }
+
+        std::shared_ptr<const Cutter> cutter = cutterCache.get(job, workpiece.heightUnit);
+        // 刀位是刀具采样网格的原点，相对刀尖在x、z方向各偏移一个半径
+        glm::vec3 origin = job.start - glm::vec3(cutter->middleX, 0.0f, cutter->middleZ);
+        PathPlayer player(job.program, origin, job.feed);
+        // 不限制单次铣削的耗时，一次推进一小时的仿真时间
+        player.frameBudget = 1e9;
+        // 体积与面积按被修改的分块增量统计
+        workpiece.takeDirtyTiles();
+        StockStats stats(workpiece, job.bottom);
+        if (job.logPath.empty())
+        {
+            while (!player.finished())
+            {
+                player.advance(workpiece, *cutter, 3600.0);
+            }
+            stats.update(workpiece, workpiece.takeDirtyTiles());
+        }
+        else
+        {
+            // 按固定的仿真时间间隔推进，每步记录一帧，同一作业在不同版本下的帧可以逐一对齐
+            DeltaWriter writer(workpiece, job.logPath);
+            if (!writer.isOpen())
+            {
+                result.status = "failed";
+                result.message = "cannot write " + job.logPath;
+                return result;
+            }
+            double time = 0.0;
+            while (!player.finished())
+            {
+                player.advance(workpiece, *cutter, job.logInterval);
+                time += job.logInterval;
+                std::vector<int> tiles = workpiece.takeDirtyTiles();
+                writer.record(workpiece, tiles, time, player.getPosition(), player.getAxis());
+                stats.update(workpiece, tiles);
+            }
+        }
+
+        result.stamps = job.program.empty() ? 0 : 1;
+        for (const Toolpath &path : job.program)
+        {
+            float feed = path.feed > 0.0f ? path.feed : job.feed;
+            result.stamps += std::max(path.length, 0);
+            result.machiningSeconds += std::max(path.length, 0) * glm::length(path.direction) * job.precision / (feed / 60.0);
+        }
+
+        uint64_t hash = 1469598103934665603ull;
+        result.minDepth = std::numeric_limits<float>::max();
+        for (int x = 0; x < job.length; x++)
+        {
+            for (int z = 0; z < job.width; z++)
+            {
+                float depth = workpiece.getDepth(x, z);
+                hash = fnv1a(hash, &depth, sizeof(depth));
+                result.minDepth = std::min(result.minDepth, depth);
+            }
+        }
+        result.checksum = hash;
+        result.volume = stats.volume();
+        result.removedVolume = stats.removedVolume();
+        result.machinedArea = stats.machinedArea();
+
+        if (!job.exportPath.empty() && exportWorkpieceSTL(workpiece, job.exportPath, job.bottom) < 0)
+        {
+            result.status = "failed";
+            result.message = "cannot write " + job.exportPath;
+        }
+        else
+        {
+            result.status = "ok";
+        }
+    }
+    catch (const std::bad_alloc &)
+    {
+        result.status = "failed";
+        result.message = "out of memory";
+    }
+    result.wallSeconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    return result;
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob> &jobs)
+{
+    std::vector<BatchResult> results(jobs.size());
+    int workers = std::max(1, std::min(threads > 0 ? threads : workerCount(), int(jobs.size())));
+
+    // 按预估工作量从大到小轮流分给各线程，每个队列内部也是从大到小
+    std::vector<int> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<double> work(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        work[i] = estimateWork(jobs[i]);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return work[a] > work[b]; });
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<int> jobs;
+    };
+    std::vector<Queue> queues(workers);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        queues[i % workers].jobs.push_back(order[i]);
+    }
+
+    // 自己的队列从前端取（大作业），其他线程的队列从后端窃取（小作业）
+    auto take = [&](int self) {
+        for (int k = 0; k < workers; k++)
+        {
+            Queue &queue = queues[(self + k) % workers];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty())
+            {
+                continue;
+            }
+            int job;
+            if (k == 0)
+            {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+            }
+            else
+            {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+            }
+            return job;
+        }
+        return -1;
+    };
+
+    std::mutex memoryMutex;
+    std::condition_variable memoryReleased;
+    long long reserved = 0;
+    auto worker = [&](int self) {
+        int limit = threadLimit();
+        threadLimit() = 1;
+        for (int index = take(self); index >= 0; index = take(self))
+        {
+            const BatchJob &job = jobs[index];
+            long long need = estimateMemory(job);
+            if (memoryLimit > 0 && need > memoryLimit)
+            {
+                BatchResult &result = results[index];
+                result.name = job.name;
+                result.status = "skipped";
+                result.message = "estimated memory exceeds the limit";
+                result.memoryBytes = need;
+                continue;
+            }
+            {
+                // 内存不足时等待其他作业结束；没有作业在运行时总是可以开始
+                std::unique_lock<std::mutex> lock(memoryMutex);
+                memoryReleased.wait(lock, [&]() { return memoryLimit <= 0 || reserved == 0 || reserved + need <= memoryLimit; });
+                reserved += need;
+            }
+            results[index] = runJob(job);
+            results[index].worker = self;
+            {
+                std::lock_guard<std::mutex> lock(memoryMutex);
+                reserved -= need;
+            }
+            memoryReleased.notify_all();
+        }
+        threadLimit() = limit;
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 1; t < workers; t++)
+    {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+    return results;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <glm/glm.hpp>
+#include "cutter.hpp"
+#include "player.hpp"
+#include "workpiece.hpp"
+
+// 批量仿真中的一个作业：毛坯、刀具与刀路程序相互独立
+struct BatchJob
+{
+    std::string name;
+    // 毛坯：网格数、精度、深度格式、初始顶面高度与底面高度（毫米），可选一个STL/OBJ网格作为毛坯
+    int length = 200;
+    int width = 200;
+    float precision = 0.2f;
+    HeightFormat format = HeightFormat::Float;
+    float top = 0.0f;
+    float bottom = -10.0f;
+    std::string meshPath;
+    // 刀具：半径、圆角半径与刀杆长度均为网格数
+    CutterShape shape = CutterShape::Ball;
+    float radius = 6.0f;
+    float cornerRadius = 0.0f;
+    float shankLength = 50.0f;
+    // 刀路：起点为刀尖位置（网格坐标），进给速度单位为mm/min
+    glm::vec3 start = glm::vec3(0.0f);
+    float feed = 150.0f;
+    std::vector<Toolpath> program;
+    // 非空时仿真结束后导出STL
+    std::string exportPath;
+    // 非空时把仿真过程写成增量日志，每logInterval秒仿真时间记录一帧
+    std::string logPath;
+    double logInterval = 0.1;
+};
+
+struct BatchResult
+{
+    std::string name;
+    // ok、failed或skipped
+    std::string status;
+    std::string message;
+    long long stamps = 0;
+    // 按进给速度计算的加工时间与实际仿真耗时（秒）
+    double machiningSeconds = 0.0;
+    double wallSeconds = 0.0;
+    // 预估内存（字节）
+    long long memoryBytes = 0;
+    float minDepth = 0.0f;
+    // 剩余体积、切除体积（立方毫米）与已加工表面积（平方毫米），见StockStats
+    double volume = 0.0;
+    double removedVolume = 0.0;
+    double machinedArea = 0.0;
+    // 最终深度数据的FNV-1a校验值，用于比较不同版本的仿真结果
+    uint64_t checksum = 0;
+    int worker = -1;
+};
+
+// 读取作业列表文件，格式见batch.cpp；失败时返回false并给出错误信息
+bool loadBatchJobs(const std::string &path, std::vector<BatchJob> &jobs, std::string &error);
+
+// 按参数共享的只读刀具表：同样的刀具只采样、量化一次，所有作业共用
+class CutterCache
+{
+public:
+    std::shared_ptr<const Cutter> get(const BatchJob &job, float heightUnit);
+    size_t size() const;
+
+private:
+    using Key = std::tuple<int, float, float, float, float, float>;
+    mutable std::mutex mutex;
+    std::map<Key, std::shared_ptr<const Cutter>> cutters;
+};
+
+// 多作业并行调度：每个工作线程有自己的作业队列，队列空了就从其他线程的队列另一端窃取；
+// 作业按预估工作量从大到小分发，大作业先开始、小作业用来填补空闲线程；
+// 正在运行的作业预估内存之和不超过memoryLimit，单个超出上限的作业不运行
+class BatchRunner
+{
+public:
+    int threads = 0;
+    long long memoryLimit = 0;
+
+    std::vector<BatchResult> run(const std::vector<BatchJob> &jobs);
+
+    // 作业运行时所需内存与工作量的预估
+    static long long estimateMemory(const BatchJob &job);
+    static double estimateWork(const BatchJob &job);
+
+private:
+    CutterCache cutterCache;
+
+    BatchResult runJob(const BatchJob &job);
+};
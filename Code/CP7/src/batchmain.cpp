@@ -0,0 +1,101 @@
+// 批量仿真：不创建窗口，并行运行作业列表中的所有作业，结果以JSON输出
+// 用法：ZMapBatch <jobs.txt> [--threads 8] [--memory-mb 4096] [--out report.json]
+#include "batch.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void writeReport(std::ostream &out, const std::vector<BatchResult> &results, int threads, double seconds)
+{
+    int ok = 0;
+    int failed = 0;
+    int skipped = 0;
+    for (const BatchResult &r : results)
+    {
+        ok += r.status == "ok";
+        failed += r.status == "failed";
+        skipped += r.status == "skipped";
+    }
+    char line[512];
+    std::snprintf(line, sizeof(line), "{\n  \"jobs\": %d, \"ok\": %d, \"failed\": %d, \"skipped\": %d, \"threads\": %d, \"seconds\": %.6g,\n",
+                  int(results.size()), ok, failed, skipped, threads, seconds);
+    out << line << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BatchResult &r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"status\": \"" << r.status << "\"";
+        if (!r.message.empty())
+        {
+            out << ", \"message\": \"" << r.message << "\"";
+        }
+        if (r.status == "ok")
+        {
+            std::snprintf(line, sizeof(line),
+                          ", \"stamps\": %lld, \"machining_seconds\": %.6g, \"wall_seconds\": %.6g, \"memory_bytes\": %lld, "
+                          "\"min_depth\": %.6g, \"volume\": %.9g, \"removed_volume\": %.9g, \"machined_area\": %.9g, "
+                          "\"checksum\": \"%016llx\", \"worker\": %d",
+                          r.stamps, r.machiningSeconds, r.wallSeconds, r.memoryBytes, r.minDepth, r.volume, r.removedVolume,
+                          r.machinedArea, (unsigned long long)r.checksum, r.worker);
+            out << line;
+        }
+        out << (i + 1 < results.size() ? "},\n" : "}\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: ZMapBatch <jobs.txt> [--threads N] [--memory-mb M] [--out report.json]" << std::endl;
+        return 2;
+    }
+    BatchRunner runner;
+    std::string outPath;
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--threads")
+            runner.threads = std::atoi(argv[i + 1]);
+        else if (option == "--memory-mb")
+            runner.memoryLimit = std::atoll(argv[i + 1]) * 1024 * 1024;
+        else if (option == "--out")
+            outPath = argv[i + 1];
+    }
+
+    std::vector<BatchJob> jobs;
+    std::string error;
+    if (!loadBatchJobs(argv[1], jobs, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = runner.run(jobs);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int threads = runner.threads > 0 ? runner.threads : int(std::thread::hardware_concurrency());
+
+    if (outPath.empty())
+    {
+        writeReport(std::cout, results, threads, seconds);
+    }
+    else
+    {
+        std::ofstream out(outPath);
+        writeReport(out, results, threads, seconds);
+    }
+    for (const BatchResult &r : results)
+    {
+        if (r.status != "ok")
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,578 @@
+// Z-map 铣削核心的微基准测试，不需要GPU和窗口
+// 用法：ZMapBench [--sizes 200,1000,5000,20000] [--radii 3,6,12] [--stamps 20000] [--mesh-limit 4000000] [--out result.json]
+// 结果以JSON输出到标准输出或--out指定的文件
+// 定义ZMAP_BENCH_GPU编译（ZMapGpuBench目标）时另有--gpu on：创建不可见窗口，比较GpuZMap与CPU铣削的结果与耗时；
+// 没有GPU时可用Mesa llvmpipe运行（LIBGL_ALWAYS_SOFTWARE=1）
+#include "cutter.hpp"
+#include "player.hpp"
+#include "workpiece.hpp"
+#ifdef ZMAP_BENCH_GPU
+#include "gpuzmap.hpp"
+#include <GLFW/glfw3.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#ifdef ZMAP_BENCH_GPU
+// GpuZMap着色器所在目录，由CMakeLists.txt定义
+#ifndef ASSETS_PATH
+#define ASSETS_PATH "src/shaders/"
+#endif
+#endif
+
+// 统计分配次数与字节数
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<long long> allocationCount(0);
+static std::atomic<long long> allocationBytes(0);
+
+void *operator new(std::size_t size)
+{
+    allocationCount++;
+    allocationBytes += size;
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// 进程的峰值常驻内存（字节）
+static long long peakMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return (long long)counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (long long)usage.ru_maxrss;
+#else
+    return (long long)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+struct BenchResult
+{
+    std::string name;
+    int grid = 0;
+    int radius = 0;
+    std::string path;
+    int iterations = 0;
+    double seconds = 0.0;
+    double cells = 0.0;
+    double allocations = 0.0;
+    double allocatedBytes = 0.0;
+    long long peakBytes = 0;
+    std::string skipped;
+    // 与CPU铣削结果的最大高度差（毫米），小于0表示不比较
+    double maxError = -1.0;
+};
+
+// 按名称、网格尺寸、刀具半径与刀路创建结果，其余字段为默认值
+static BenchResult makeResult(const std::string &name, int grid, int radius, const std::string &path)
+{
+    BenchResult result;
+    result.name = name;
+    result.grid = grid;
+    result.radius = radius;
+    result.path = path;
+    return result;
+}
+
+// 重复执行fn直到累计时间超过minSeconds，返回单次平均耗时；setup不计入时间
+static void measure(BenchResult &result, const std::function<void()> &setup, const std::function<void()> &fn, double minSeconds = 0.2)
+{
+    using Clock = std::chrono::steady_clock;
+    double total = 0.0;
+    int iterations = 0;
+    long long allocations = 0;
+    long long bytes = 0;
+    do
+    {
+        setup();
+        long long count0 = allocationCount;
+        long long bytes0 = allocationBytes;
+        auto start = Clock::now();
+        fn();
+        total += std::chrono::duration<double>(Clock::now() - start).count();
+        allocations += allocationCount - count0;
+        bytes += allocationBytes - bytes0;
+        iterations++;
+    } while (total < minSeconds && iterations < 1000);
+    result.iterations = iterations;
+    result.seconds = total / iterations;
+    result.allocations = double(allocations) / iterations;
+    result.allocatedBytes = double(bytes) / iterations;
+    result.peakBytes = peakMemory();
+}
+
+// 按形状生成刀路，总步数不超过stampBudget；起点为(margin, y, margin)
+static std::vector<Toolpath> makePath(const std::string &shape, int grid, int radius, long long stampBudget)
+{
+    std::vector<Toolpath> path;
+    int span = std::max(1, grid - 2 * radius - 2);
+    long long stamps = 0;
+    // 先下刀到切削深度
+    path.push_back({glm::vec3(0.0f, -1.0f, 0.0f), 2});
+    if (shape == "line")
+    {
+        // 一条对角直线
+        int length = int(std::min<long long>(span, stampBudget));
+        path.push_back({glm::vec3(1.0f, 0.0f, 1.0f), length});
+    }
+    else if (shape == "zigzag")
+    {
+        // 行距为刀具半径的往复走刀
+        float dir = 1.0f;
+        for (int x = 0; x + radius < span && stamps < stampBudget; x += radius)
+        {
+            path.push_back({glm::vec3(0.0f, 0.0f, dir), span});
+            path.push_back({glm::vec3(1.0f, 0.0f, 0.0f), radius});
+            stamps += span + radius;
+            dir = -dir;
+        }
+    }
+    else if (shape == "spiral")
+    {
+        // 由外向内的方形螺旋
+        const glm::vec3 dirs[4] = {{0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}};
+        int length = span;
+        for (int k = 0; length > 0 && stamps < stampBudget; k++)
+        {
+            path.push_back({dirs[k % 4], length});
+            stamps += length;
+            if (k % 2 == 1)
+            {
+                length -= radius;
+            }
+        }
+    }
+    else if (shape == "plunge")
+    {
+        // 网格状分布的钻孔：下刀、抬刀、平移
+        int step = std::max(2 * radius, span / 64);
+        for (int x = 0; x + step < span && stamps < stampBudget; x += step)
+        {
+            int travel = 0;
+            for (int z = 0; z + step < span && stamps < stampBudget; z += step)
+            {
+                path.push_back({glm::vec3(0.0f, -1.0f, 0.0f), radius});
+                path.push_back({glm::vec3(0.0f, 1.0f, 0.0f), radius});
+                path.push_back({glm::vec3(0.0f, 0.0f, 1.0f), step});
+                stamps += 2 * radius + step;
+                travel += step;
+            }
+            path.push_back({glm::vec3(1.0f, 0.0f, 0.0f), step});
+            path.push_back({glm::vec3(0.0f, 0.0f, -1.0f), travel});
+            stamps += step + travel;
+        }
+    }
+    return path;
+}
+
+static std::vector<int> parseList(const char *text)
+{
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        values.push_back(std::atoi(item.c_str()));
+    }
+    return values;
+}
+
+static void writeJson(std::ostream &out, const std::vector<BenchResult> &results)
+{
+    out << "{\n  \"benchmark\": \"zmap\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"grid\": " << r.grid << ", \"radius\": " << r.radius
+            << ", \"path\": \"" << r.path << "\"";
+        if (!r.skipped.empty())
+        {
+            out << ", \"skipped\": \"" << r.skipped << "\"}";
+        }
+        else
+        {
+            char line[512];
+            std::snprintf(line, sizeof(line),
+                          ", \"iterations\": %d, \"seconds\": %.9g, \"cells\": %.0f, \"ns_per_cell\": %.6g, "
+                          "\"cells_per_second\": %.6g, \"allocations\": %.6g, \"allocated_bytes\": %.6g, "
+                          "\"peak_rss_bytes\": %lld",
+                          r.iterations, r.seconds, r.cells, r.seconds * 1e9 / r.cells, r.cells / r.seconds,
+                          r.allocations, r.allocatedBytes, r.peakBytes);
+            out << line;
+            if (r.maxError >= 0.0)
+            {
+                std::snprintf(line, sizeof(line), ", \"max_error\": %.6g", r.maxError);
+                out << line;
+            }
+            out << "}";
+        }
+        out << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// 所有网格深度置为0
+static void initWorkpieceData(WorkPiece &workpiece)
+{
+    for (int x = 0; x < workpiece.length; x++)
+    {
+        for (int z = 0; z < workpiece.width; z++)
+        {
+            workpiece.setDepth(x, z, 0.0f);
+        }
+    }
+}
+
+#ifdef ZMAP_BENCH_GPU
+// 创建不可见窗口作为OpenGL 3.3上下文，失败时（如没有显示设备）返回nullptr
+static GLFWwindow *createOffscreenContext()
+{
+    if (!glfwInit())
+    {
+        return nullptr;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    GLFWwindow *window = glfwCreateWindow(16, 16, "ZMapBench", nullptr, nullptr);
+    if (window == nullptr)
+    {
+        glfwTerminate();
+        return nullptr;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return nullptr;
+    }
+    return window;
+}
+
+// 两个工件深度的最大差值
+static double maxDifference(const WorkPiece &a, const WorkPiece &b)
+{
+    double diff = 0.0;
+    for (int x = 0; x < a.length; x++)
+    {
+        for (int z = 0; z < a.width; z++)
+        {
+            diff = std::max(diff, double(std::fabs(a.getDepth(x, z) - b.getDepth(x, z))));
+        }
+    }
+    return diff;
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+    std::vector<int> sizes = {200, 1000, 5000, 20000};
+    std::vector<int> radii = {3, 6, 12};
+    std::vector<std::string> shapes = {"line", "zigzag", "spiral", "plunge"};
+    // 超过该网格数时跳过建网格的测试（顶点数据约为深度数据的12倍）
+    long long meshLimit = 4000000;
+    long long stampBudget = 20000;
+    bool useGpu = false;
+    std::string outPath;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--sizes")
+            sizes = parseList(argv[i + 1]);
+        else if (option == "--radii")
+            radii = parseList(argv[i + 1]);
+        else if (option == "--mesh-limit")
+            meshLimit = std::atoll(argv[i + 1]);
+        else if (option == "--stamps")
+            stampBudget = std::atoll(argv[i + 1]);
+        else if (option == "--gpu")
+            useGpu = std::string(argv[i + 1]) == "on";
+        else if (option == "--out")
+            outPath = argv[i + 1];
+    }
+#ifdef ZMAP_BENCH_GPU
+    GLFWwindow *context = useGpu ? createOffscreenContext() : nullptr;
+    GLint maxTextureSize = 0;
+    if (context != nullptr)
+    {
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    }
+#else
+    if (useGpu)
+    {
+        std::cerr << "ZMapBench is built without GPU support, use ZMapGpuBench for --gpu on" << std::endl;
+    }
+#endif
+
+    const float precision = 0.2f;
+    std::vector<BenchResult> results;
+    auto report = [&](const BenchResult &r) {
+        results.push_back(r);
+        std::cerr << r.name << " grid=" << r.grid << " radius=" << r.radius << " path=" << r.path
+                  << (r.skipped.empty() ? "" : " skipped") << std::endl;
+    };
+
+    // 刀具采样
+    for (int radius : radii)
+    {
+        BenchResult r = makeResult("samplingBall", 0, radius, "");
+        int cells = (2 * radius + 1) * (2 * radius + 1);
+        r.cells = cells;
+        Cutter *cutter = nullptr;
+        measure(
+            r,
+            [&]() {
+                delete cutter;
+                cutter = new Cutter(float(radius), precision, float(radius), float(radius - 2), float(radius), glm::vec3(0.0f));
+            },
+            [&]() { cutter->samplingBall(); });
+        delete cutter;
+        report(r);
+    }
+
+    for (int grid : sizes)
+    {
+        WorkPiece workpiece(grid, grid, precision);
+
+        // 铣削更新
+        for (int radius : radii)
+        {
+            Cutter cutter(float(radius), precision, float(radius), float(radius - 2), float(radius), glm::vec3(0.0f));
+            cutter.samplingBall();
+            for (const std::string &shape : shapes)
+            {
+                BenchResult r = makeResult("updateZmap", grid, radius, shape);
+                std::vector<Toolpath> path = makePath(shape, grid, radius, stampBudget);
+                long long stamps = 0;
+                for (const Toolpath &segment : path)
+                {
+                    stamps += segment.length;
+                }
+                r.cells = double(stamps) * cutter.width * cutter.length;
+                measure(
+                    r, [&]() { initWorkpieceData(workpiece); },
+                    [&]() {
+                        glm::vec3 position(float(radius + 1), 0.0f, float(radius + 1));
+                        for (const Toolpath &segment : path)
+                        {
+                            updateZmap(workpiece, cutter, segment, position);
+                        }
+                    });
+                report(r);
+            }
+
+            // 倾斜刀轴的铣削（按刀具几何逐点求交），沿对角直线走刀
+            const char *cutterShapes[] = {"ball", "flat", "bullnose"};
+            for (int s = 0; s < 3; s++)
+            {
+                BenchResult r = makeResult("stampTilted", grid, radius, cutterShapes[s]);
+                cutter.shape = CutterShape(s);
+                cutter.cornerRadius = radius * 0.5f;
+                int stamps = int(std::min<long long>(std::max(1, grid - 2 * radius - 2), stampBudget));
+                r.cells = double(stamps) * cutter.width * cutter.length;
+                measure(
+                    r, [&]() { initWorkpieceData(workpiece); },
+                    [&]() {
+                        for (int m = 0; m < stamps; m++)
+                        {
+                            workpiece.stampCutter(cutter, glm::vec3(float(radius + 1 + m), -2.0f, float(radius + 1 + m)), glm::vec3(0.5f, 1.0f, 0.3f));
+                        }
+                    });
+                report(r);
+            }
+
+#ifdef ZMAP_BENCH_GPU
+            // GPU铣削：与updateZmap相同的刀路，逐刀位光栅化（gpuStamps）或每段刀路作为一个扫掠体（gpuSweep）；
+            // 计时包括提交与glFinish，不包括读回；max_error为与CPU结果的最大差值，扫掠会切除离散刀位之间留下的残留高度
+            if (useGpu)
+            {
+                cutter.shape = CutterShape::Ball;
+                const char *gpuModes[] = {"gpuStamps", "gpuSweep"};
+                for (const std::string &shape : shapes)
+                {
+                    std::vector<Toolpath> path = makePath(shape, grid, radius, stampBudget);
+                    long long stamps = 0;
+                    for (const Toolpath &segment : path)
+                    {
+                        stamps += segment.length;
+                    }
+                    for (const char *mode : gpuModes)
+                    {
+                        BenchResult r = makeResult(mode, grid, radius, shape);
+                        r.cells = double(stamps) * cutter.width * cutter.length;
+                        if (context == nullptr)
+                        {
+                            r.skipped = "no OpenGL context";
+                            report(r);
+                            continue;
+                        }
+                        if (grid > maxTextureSize)
+                        {
+                            r.skipped = "grid exceeds GL_MAX_TEXTURE_SIZE";
+                            report(r);
+                            continue;
+                        }
+                        // CPU结果作为参照
+                        WorkPiece reference(grid, grid, precision);
+                        initWorkpieceData(reference);
+                        glm::vec3 position(float(radius + 1), 0.0f, float(radius + 1));
+                        for (const Toolpath &segment : path)
+                        {
+                            updateZmap(reference, cutter, segment, position);
+                        }
+                        initWorkpieceData(workpiece);
+                        GpuZMap gpu(workpiece, ASSETS_PATH);
+                        bool sweep = std::string(mode) == "gpuSweep";
+                        measure(
+                            r,
+                            [&]() {
+                                initWorkpieceData(workpiece);
+                                gpu.upload();
+                                glFinish();
+                            },
+                            [&]() {
+                                glm::vec3 position(float(radius + 1), 0.0f, float(radius + 1));
+                                glm::vec3 previous = position;
+                                for (const Toolpath &segment : path)
+                                {
+                                    if (segment.length > 0 && sweep)
+                                    {
+                                        // 依次经过updateZmap实际铣削的刀位：段的起点与最后一个刀位
+                                        glm::vec3 last = position + segment.direction * float(segment.length - 1);
+                                        gpu.sweep(cutter, previous, position);
+                                        gpu.sweep(cutter, position, last);
+                                        previous = last;
+                                    }
+                                    else if (!sweep)
+                                    {
+                                        for (int m = 0; m < segment.length; m++)
+                                        {
+                                            gpu.stampCutter(cutter, position + segment.direction * float(m));
+                                        }
+                                    }
+                                    position += segment.direction * float(segment.length);
+                                }
+                                gpu.flush();
+                                glFinish();
+                            });
+                        gpu.synchronize();
+                        r.maxError = maxDifference(workpiece, reference);
+                        report(r);
+                    }
+                }
+                // 读回全部分块，每种网格尺寸只测一次
+                if (context != nullptr && grid <= maxTextureSize && radius == radii.front())
+                {
+                    BenchResult r = makeResult("gpuReadback", grid, 0, "");
+                    r.cells = double(grid) * grid;
+                    GpuZMap gpu(workpiece, ASSETS_PATH);
+                    std::vector<int> tiles(size_t(workpiece.tilesX) * workpiece.tilesZ);
+                    for (size_t i = 0; i < tiles.size(); i++)
+                    {
+                        tiles[i] = int(i);
+                    }
+                    measure(r, []() {}, [&]() { gpu.download(tiles); });
+                    report(r);
+                }
+            }
+#endif
+        }
+
+        // 网格生成
+        long long cells = (long long)(grid - 1) * (grid - 1);
+        const char *meshSteps[] = {"depthToCoords", "generateIndices", "generateLineIndices"};
+        for (const char *name : meshSteps)
+        {
+            BenchResult r = makeResult(name, grid, 0, "");
+            r.cells = double(cells);
+            if (cells > meshLimit)
+            {
+                r.skipped = "grid exceeds --mesh-limit";
+                report(r);
+                continue;
+            }
+            std::string step = name;
+            if (step != "depthToCoords")
+            {
+                workpiece.depthToCoords();
+            }
+            measure(
+                r, []() {},
+                [&]() {
+                    if (step == "depthToCoords")
+                        workpiece.depthToCoords();
+                    else if (step == "generateIndices")
+                        workpiece.generateIndices();
+                    else
+                        workpiece.generateLineIndices();
+                });
+            report(r);
+        }
+        workpiece.zmapCoords = {};
+        workpiece.zmapIndices = {};
+        workpiece.lineIndices = {};
+    }
+
+    if (outPath.empty())
+    {
+        writeJson(std::cout, results);
+    }
+    else
+    {
+        std::ofstream out(outPath);
+        writeJson(out, results);
+    }
+#ifdef ZMAP_BENCH_GPU
+    if (context != nullptr)
+    {
+        glfwDestroyWindow(context);
+        glfwTerminate();
+    }
+#endif
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include "cutter.hpp"
+#include <algorithm>
+#include <cmath>
 void Cutter::generateLowerHemisphere()
 {
     // 精度：生成的纵向和横向分段数
@@ -124,4 +126,16 @@ void Cutter::samplingBall()
             }
         }
     }
-}
\ No newline at end of file
+}
+
+void Cutter::quantizeProfile(float unit)
+{
+    fixedUnit = unit;
+    fixedDepth.resize(depthData.size());
+    fixedMin = INT32_MAX;
+    for (size_t i = 0; i < depthData.size(); i++)
+    {
+        fixedDepth[i] = int32_t(std::lround(depthData[i] / unit));
+        fixedMin = std::min(fixedMin, fixedDepth[i]);
+    }
+}
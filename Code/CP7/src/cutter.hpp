@@ -1,7 +1,16 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <numbers>
 #include <glm/glm.hpp>
+// 刀具类型：球头刀、平底刀、牛鼻刀（圆角平底）
+enum class CutterShape
+{
+    Ball,
+    Flat,
+    BullNose
+};
 class Cutter{
     public:
     float radius;
@@ -12,7 +21,16 @@ class Cutter{
     float middleY;
     float middleZ;
     glm::vec3 toolPoisiton;
+    // 刀具类型与牛鼻刀的圆角半径（网格数）；depthData只描述竖直的球头刀，其余情况按刀具几何直接求交
+    CutterShape shape = CutterShape::Ball;
+    float cornerRadius = 0.0f;
+    // 刀轴倾斜时参与切削的刀杆长度（网格数，从刀尖上方的圆角中心算起）
+    float shankLength = 50.0f;
     std::vector<float> depthData;
+    // 定点深度轮廓及其量化单位，供定点格式的工件使用
+    std::vector<int32_t> fixedDepth;
+    float fixedUnit = 0.0f;
+    int32_t fixedMin = 0;
     std::vector<float> ballCoords;
     std::vector<int> ballIndices;
     std::vector<int> balllineIndices;
@@ -23,4 +41,19 @@ class Cutter{
     }
     void generateLowerHemisphere();
     void samplingBall();
+    // 按量化单位unit（毫米）生成定点深度轮廓，需在samplingBall之后调用
+    void quantizeProfile(float unit);
+    // 刀尖圆角半径（网格数）：球头刀为刀具半径，平底刀为0
+    float cornerSize() const
+    {
+        switch (shape)
+        {
+        case CutterShape::Flat:
+            return 0.0f;
+        case CutterShape::BullNose:
+            return std::min(cornerRadius, radius);
+        default:
+            return radius;
+        }
+    }
 };
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "deltalog.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const char MAGIC[4] = {'Z', 'M', 'D', 'L'};
+    const uint32_t VERSION = 1;
+    const uint8_t FRAME_TAG = 'F';
+    // 文件每写出这么多字节刷新一次，关闭时写出其余部分
+    const long long FLUSH_BYTES = 1 << 20;
+
+    template <typename T>
+    void putRaw(std::vector<uint8_t> &out, T value)
+    {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    T getRaw(const uint8_t *&p)
+    {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    void putVarint(std::vector<uint8_t> &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    // 读取变长整数，越界或超长时返回false
+    bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7)
+        {
+            uint8_t byte = *p++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t zigzag(int64_t value)
+    {
+        return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return int64_t(value >> 1) ^ -int64_t(value & 1);
+    }
+
+    void tileRange(const DeltaHeader &head, int tile, int &x0, int &x1, int &z0, int &z1)
+    {
+        int tilesZ = (head.width + head.tileSize - 1) / head.tileSize;
+        x0 = (tile / tilesZ) * head.tileSize;
+        z0 = (tile % tilesZ) * head.tileSize;
+        x1 = std::min(x0 + head.tileSize, head.length);
+        z1 = std::min(z0 + head.tileSize, head.width);
+    }
+}
+
+void DeltaLog::append(const uint8_t *data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    bytes.insert(bytes.end(), data, data + size);
+}
+
+size_t DeltaLog::copy(size_t offset, std::vector<uint8_t> &out, size_t limit) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (offset >= bytes.size())
+    {
+        return bytes.size();
+    }
+    size_t end = offset + std::min(limit, bytes.size() - offset);
+    out.insert(out.end(), bytes.begin() + offset, bytes.begin() + end);
+    return end;
+}
+
+size_t DeltaLog::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes.size();
+}
+
+DeltaWriter::DeltaWriter(const WorkPiece &workpiece, const std::string &path, std::shared_ptr<DeltaLog> log)
+    : path(path), log(std::move(log)), shadow(size_t(workpiece.length) * workpiece.width, 0)
+{
+    if (!path.empty())
+    {
+        file.open(path, std::ios::binary);
+    }
+    buffer.insert(buffer.end(), MAGIC, MAGIC + 4);
+    putRaw<uint32_t>(buffer, VERSION);
+    putRaw<int32_t>(buffer, workpiece.length);
+    putRaw<int32_t>(buffer, workpiece.width);
+    putRaw<float>(buffer, workpiece.precision);
+    putRaw<float>(buffer, workpiece.heightUnit);
+    putRaw<int32_t>(buffer, WorkPiece::TILE_SIZE);
+    emit();
+
+    std::vector<int> tiles(size_t(workpiece.tilesX) * workpiece.tilesZ);
+    for (size_t i = 0; i < tiles.size(); i++)
+    {
+        tiles[i] = int(i);
+    }
+    record(workpiece, tiles, 0.0, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void DeltaWriter::emit()
+{
+    if (file)
+    {
+        file.write(reinterpret_cast<const char *>(buffer.data()), std::streamsize(buffer.size()));
+    }
+    if (log)
+    {
+        log->append(buffer.data(), buffer.size());
+    }
+    bytes += (long long)buffer.size();
+    buffer.clear();
+    if (file && bytes - flushedBytes >= FLUSH_BYTES)
+    {
+        file.flush();
+        flushedBytes = bytes;
+    }
+}
+
+void DeltaWriter::record(const WorkPiece &workpiece, const std::vector<int> &tiles, double time, glm::vec3 position, glm::vec3 axis)
+{
+    std::vector<uint8_t> body;
+    putRaw<double>(body, time);
+    for (int i = 0; i < 3; i++)
+    {
+        putRaw<float>(body, position[i]);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        putRaw<float>(body, axis[i]);
+    }
+    putVarint(body, tiles.size());
+
+    std::vector<uint64_t> literals;
+    std::vector<uint8_t> runs;
+    for (int tile : tiles)
+    {
+        int x0, x1, z0, z1;
+        workpiece.tileBounds(tile, x0, x1, z0, z1);
+        // 分块内按行展开，每段为连续0的个数、其后非0高度差的个数与这些高度差
+        uint64_t zeros = 0;
+        uint64_t runCount = 0;
+        literals.clear();
+        runs.clear();
+        auto flush = [&]() {
+            putVarint(runs, zeros);
+            putVarint(runs, literals.size());
+            for (uint64_t literal : literals)
+            {
+                putVarint(runs, literal);
+            }
+            literals.clear();
+            zeros = 0;
+            runCount++;
+        };
+        for (int x = x0; x < x1; x++)
+        {
+            for (int z = z0; z < z1; z++)
+            {
+                int32_t &previous = shadow[size_t(x) * workpiece.width + z];
+                int32_t value = workpiece.quantize(workpiece.getDepth(x, z));
+                int64_t delta = int64_t(value) - previous;
+                previous = value;
+                if (delta == 0)
+                {
+                    if (!literals.empty())
+                    {
+                        flush();
+                    }
+                    zeros++;
+                }
+                else
+                {
+                    literals.push_back(zigzag(delta));
+                }
+            }
+        }
+        // 末尾的连续0不需要记录
+        if (!literals.empty())
+        {
+            flush();
+        }
+        putVarint(body, uint64_t(tile));
+        putVarint(body, runCount);
+        body.insert(body.end(), runs.begin(), runs.end());
+    }
+
+    buffer.push_back(FRAME_TAG);
+    putVarint(buffer, body.size());
+    buffer.insert(buffer.end(), body.begin(), body.end());
+    emit();
+    frames++;
+}
+
+void DeltaReader::feed(const uint8_t *data, size_t size)
+{
+    // 丢弃已经解码的部分，避免缓冲无限增长
+    if (offset > 0 && offset == buffer.size())
+    {
+        buffer.clear();
+        offset = 0;
+    }
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+bool DeltaReader::readHeader()
+{
+    if (hasHeader)
+    {
+        return true;
+    }
+    const size_t HEADER_SIZE = 4 + 4 + 4 * 5;
+    if (error || buffer.size() - offset < HEADER_SIZE)
+    {
+        return false;
+    }
+    const uint8_t *p = buffer.data() + offset;
+    if (std::memcmp(p, MAGIC, 4) != 0)
+    {
+        error = true;
+        return false;
+    }
+    p += 4;
+    uint32_t version = getRaw<uint32_t>(p);
+    head.length = getRaw<int32_t>(p);
+    head.width = getRaw<int32_t>(p);
+    head.precision = getRaw<float>(p);
+    head.heightUnit = getRaw<float>(p);
+    head.tileSize = getRaw<int32_t>(p);
+    if (version != VERSION || head.length <= 0 || head.width <= 0 || head.tileSize <= 0)
+    {
+        error = true;
+        return false;
+    }
+    offset += HEADER_SIZE;
+    shadow.assign(size_t(head.length) * head.width, 0);
+    hasHeader = true;
+    return true;
+}
+
+bool DeltaReader::frameRange(size_t &begin, size_t &end)
+{
+    if (!readHeader() || offset >= buffer.size())
+    {
+        return false;
+    }
+    const uint8_t *p = buffer.data() + offset;
+    const uint8_t *limit = buffer.data() + buffer.size();
+    if (*p != FRAME_TAG)
+    {
+        error = true;
+        return false;
+    }
+    p++;
+    uint64_t size;
+    if (!getVarint(p, limit, size) || uint64_t(limit - p) < size)
+    {
+        return false;
+    }
+    begin = size_t(p - buffer.data());
+    end = begin + size_t(size);
+    return true;
+}
+
+bool DeltaReader::peek(double &time)
+{
+    size_t begin, end;
+    if (!frameRange(begin, end) || end - begin < sizeof(double))
+    {
+        return false;
+    }
+    const uint8_t *p = buffer.data() + begin;
+    time = getRaw<double>(p);
+    return true;
+}
+
+bool DeltaReader::next(WorkPiece &workpiece, DeltaFrame &frame)
+{
+    size_t begin, end;
+    if (!frameRange(begin, end))
+    {
+        return false;
+    }
+    if (workpiece.length != head.length || workpiece.width != head.width || workpiece.tilesZ != (head.width + head.tileSize - 1) / head.tileSize)
+    {
+        error = true;
+        return false;
+    }
+    const uint8_t *p = buffer.data() + begin;
+    const uint8_t *limit = buffer.data() + end;
+    if (limit - p < int(sizeof(double) + 6 * sizeof(float)))
+    {
+        error = true;
+        return false;
+    }
+    // 先把整帧解到decoded与changes中，校验通过后才修改shadow与workpiece，损坏的帧不会留下部分结果
+    DeltaFrame decoded;
+    decoded.time = getRaw<double>(p);
+    for (int i = 0; i < 3; i++)
+    {
+        decoded.position[i] = getRaw<float>(p);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        decoded.axis[i] = getRaw<float>(p);
+    }
+    changes.clear();
+    uint64_t count;
+    bool ok = getVarint(p, limit, count);
+    int tileCount = workpiece.tilesX * workpiece.tilesZ;
+    for (uint64_t t = 0; ok && t < count; t++)
+    {
+        uint64_t tile, runCount;
+        ok = getVarint(p, limit, tile) && tile < uint64_t(tileCount) && getVarint(p, limit, runCount);
+        if (!ok)
+        {
+            break;
+        }
+        decoded.tiles.push_back(int(tile));
+        int x0, x1, z0, z1;
+        tileRange(head, int(tile), x0, x1, z0, z1);
+        int columns = z1 - z0;
+        uint64_t cells = uint64_t(x1 - x0) * columns;
+        uint64_t cell = 0;
+        for (uint64_t r = 0; ok && r < runCount; r++)
+        {
+            uint64_t zeros, literals;
+            ok = getVarint(p, limit, zeros) && getVarint(p, limit, literals) && cell + zeros + literals <= cells;
+            cell += zeros;
+            for (uint64_t i = 0; ok && i < literals; i++, cell++)
+            {
+                uint64_t value;
+                ok = getVarint(p, limit, value);
+                int x = x0 + int(cell / columns);
+                int z = z0 + int(cell % columns);
+                changes.push_back({size_t(x) * head.width + z, unzigzag(value)});
+            }
+        }
+    }
+    if (!ok || p != limit)
+    {
+        error = true;
+        return false;
+    }
+
+    for (const CellDelta &change : changes)
+    {
+        int32_t &height = shadow[change.index];
+        height = int32_t(int64_t(height) + change.delta);
+        workpiece.setDepth(int(change.index / head.width), int(change.index % head.width), float(height) * head.heightUnit);
+    }
+    for (int tile : decoded.tiles)
+    {
+        int x0, x1, z0, z1;
+        tileRange(head, tile, x0, x1, z0, z1);
+        workpiece.markDirty(x0, x1, z0, z1);
+    }
+    frame = std::move(decoded);
+    offset = end;
+    return true;
+}
+
+bool loadDeltaFile(const std::string &path, DeltaReader &reader)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    reader.feed(data.data(), data.size());
+    return reader.readHeader();
+}
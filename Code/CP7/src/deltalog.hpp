@@ -0,0 +1,118 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "workpiece.hpp"
+
+// Z-map增量日志：记录每个仿真步被修改的分块，供回放、跨进程查看与不同版本之间的结果比较
+// 文件由文件头与依次追加的帧组成，第一帧包含全部分块（相对于全0的初始值）；
+// 每帧记录仿真时间、刀位、刀轴与被修改的分块，分块内为按heightUnit量化后的高度差，
+// 经zigzag与变长整数编码，连续的0（未变化的网格）只记录个数；多字节数值按小端序存储
+
+// 日志的公共参数
+struct DeltaHeader
+{
+    int length = 0;
+    int width = 0;
+    float precision = 0.0f;
+    float heightUnit = 0.0f;
+    int tileSize = 0;
+};
+
+// 一帧的信息：仿真时间（秒）、刀位（与PathPlayer::getPosition相同的网格坐标）、刀轴与被修改的分块
+struct DeltaFrame
+{
+    double time = 0.0;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f);
+    std::vector<int> tiles;
+};
+
+// 线程安全的只追加字节缓冲，用于把正在写的日志交给DeltaServer
+class DeltaLog
+{
+public:
+    void append(const uint8_t *data, size_t size);
+    // 把offset之后的字节（最多limit个）追加到out，返回新的offset
+    size_t copy(size_t offset, std::vector<uint8_t> &out, size_t limit = SIZE_MAX) const;
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<uint8_t> bytes;
+};
+
+class DeltaWriter
+{
+public:
+    // 写出文件头与包含全部分块的第一帧；path为空时不写文件，log为空时不写缓冲
+    DeltaWriter(const WorkPiece &workpiece, const std::string &path, std::shared_ptr<DeltaLog> log = nullptr);
+
+    bool isOpen() const { return !path.empty() ? bool(file) : true; }
+
+    // 记录一个仿真步：tiles为该步被修改的分块（通常来自takeDirtyTiles）
+    void record(const WorkPiece &workpiece, const std::vector<int> &tiles, double time, glm::vec3 position, glm::vec3 axis);
+
+    // 已写出的帧数与字节数
+    long long frames = 0;
+    long long bytes = 0;
+
+private:
+    std::string path;
+    std::ofstream file;
+    std::shared_ptr<DeltaLog> log;
+    // 上一次记录时各网格的量化高度
+    std::vector<int32_t> shadow;
+    std::vector<uint8_t> buffer;
+    // 上一次刷新文件时已写出的字节数
+    long long flushedBytes = 0;
+
+    void emit();
+};
+
+// 增量解码，数据可以分多次提供（如从网络接收）
+class DeltaReader
+{
+public:
+    void feed(const uint8_t *data, size_t size);
+
+    // 文件头是否已经读到
+    bool readHeader();
+    const DeltaHeader &header() const { return head; }
+
+    // 下一帧是否完整，完整时给出其仿真时间
+    bool peek(double &time);
+
+    // 解出下一帧并应用到workpiece（尺寸须与文件头一致），被修改的分块标记为dirty；数据不完整时返回false，
+    // 帧数据错误时返回false且failed()为true，workpiece与frame保持不变
+    bool next(WorkPiece &workpiece, DeltaFrame &frame);
+
+    // 数据格式错误
+    bool failed() const { return error; }
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t offset = 0;
+    bool hasHeader = false;
+    bool error = false;
+    DeltaHeader head;
+    std::vector<int32_t> shadow;
+
+    // 解码中的一帧：网格在shadow中的下标与高度差
+    struct CellDelta
+    {
+        size_t index;
+        int64_t delta;
+    };
+    std::vector<CellDelta> changes;
+
+    // 下一帧在buffer中的范围
+    bool frameRange(size_t &begin, size_t &end);
+};
+
+// 读入整个日志文件
+bool loadDeltaFile(const std::string &path, DeltaReader &reader);
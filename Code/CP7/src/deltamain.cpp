@@ -0,0 +1,188 @@
+// 增量日志工具：查看日志信息，或逐帧回放两个日志比较结果（例如同一刀路在不同版本引擎下的仿真）
+// 用法：ZMapDelta info <a.zdl>
+//       ZMapDelta compare <a.zdl> <b.zdl> [--tolerance 0.001]
+// compare在两个日志的最终结果相差超过tolerance（毫米）时返回1
+#include "deltalog.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <string>
+
+static bool openLog(const std::string &path, DeltaReader &reader)
+{
+    if (!loadDeltaFile(path, reader))
+    {
+        std::cerr << "cannot read delta log: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static WorkPiece makeWorkpiece(const DeltaHeader &head)
+{
+    // 回放总是写入Float格式，数值为量化后的高度
+    return WorkPiece(head.length, head.width, head.precision, HeightFormat::Float, head.heightUnit);
+}
+
+// 两个工件在给定分块上的最大高度差，同时更新maxDiff
+static float tileDifference(const WorkPiece &a, const WorkPiece &b, int tile, float &maxDiff)
+{
+    int x0, x1, z0, z1;
+    a.tileBounds(tile, x0, x1, z0, z1);
+    float tileMax = 0.0f;
+    for (int x = x0; x < x1; x++)
+    {
+        for (int z = z0; z < z1; z++)
+        {
+            tileMax = std::max(tileMax, std::fabs(a.getDepth(x, z) - b.getDepth(x, z)));
+        }
+    }
+    maxDiff = std::max(maxDiff, tileMax);
+    return tileMax;
+}
+
+static float minDepth(const WorkPiece &workpiece)
+{
+    float depth = std::numeric_limits<float>::max();
+    for (int x = 0; x < workpiece.length; x++)
+    {
+        for (int z = 0; z < workpiece.width; z++)
+        {
+            depth = std::min(depth, workpiece.getDepth(x, z));
+        }
+    }
+    return depth;
+}
+
+static int info(const std::string &path)
+{
+    DeltaReader reader;
+    if (!openLog(path, reader))
+    {
+        return 1;
+    }
+    const DeltaHeader &head = reader.header();
+    WorkPiece workpiece = makeWorkpiece(head);
+    DeltaFrame frame;
+    long long frames = 0;
+    long long tiles = 0;
+    long long rawBytes = 0;
+    double duration = 0.0;
+    while (reader.next(workpiece, frame))
+    {
+        frames++;
+        tiles += (long long)frame.tiles.size();
+        for (int tile : frame.tiles)
+        {
+            int x0, x1, z0, z1;
+            workpiece.tileBounds(tile, x0, x1, z0, z1);
+            rawBytes += (long long)(x1 - x0) * (z1 - z0) * (long long)sizeof(float);
+        }
+        duration = frame.time;
+    }
+    workpiece.takeDirtyTiles();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    long long bytes = (long long)file.tellg();
+    std::printf("{\"grid\": [%d, %d], \"precision\": %g, \"height_unit\": %g, \"tile_size\": %d, \"frames\": %lld, \"tiles\": %lld, "
+                "\"bytes\": %lld, \"raw_bytes\": %lld, \"ratio\": %.3f, \"seconds\": %.6g, \"min_depth\": %.6g, \"valid\": %s}\n",
+                head.length, head.width, head.precision, head.heightUnit, head.tileSize, frames, tiles, bytes, rawBytes,
+                bytes > 0 ? double(rawBytes) / double(bytes) : 0.0, duration, minDepth(workpiece), reader.failed() ? "false" : "true");
+    return reader.failed() ? 1 : 0;
+}
+
+static int compare(const std::string &pathA, const std::string &pathB, float tolerance)
+{
+    DeltaReader readerA, readerB;
+    if (!openLog(pathA, readerA) || !openLog(pathB, readerB))
+    {
+        return 1;
+    }
+    const DeltaHeader &a = readerA.header();
+    const DeltaHeader &b = readerB.header();
+    if (a.length != b.length || a.width != b.width || a.precision != b.precision || a.tileSize != b.tileSize)
+    {
+        std::printf("{\"equal\": false, \"message\": \"grid mismatch\"}\n");
+        return 1;
+    }
+    WorkPiece workA = makeWorkpiece(a);
+    WorkPiece workB = makeWorkpiece(b);
+    DeltaFrame frameA, frameB;
+    long long frames = 0;
+    long long framesA = 0;
+    long long framesB = 0;
+    long long firstDivergent = -1;
+    int divergentTile = -1;
+    float maxFrameDiff = 0.0f;
+    bool moreA = true;
+    bool moreB = true;
+    // 按帧序号对齐，比较两边该帧修改过的分块；之前一直相同的分块如果两边都没有修改，仍然相同
+    while (true)
+    {
+        moreA = moreA && readerA.next(workA, frameA);
+        moreB = moreB && readerB.next(workB, frameB);
+        if (!moreA || !moreB)
+        {
+            break;
+        }
+        frames++;
+        std::set<int> tiles(frameA.tiles.begin(), frameA.tiles.end());
+        tiles.insert(frameB.tiles.begin(), frameB.tiles.end());
+        for (int tile : tiles)
+        {
+            if (tileDifference(workA, workB, tile, maxFrameDiff) > tolerance && firstDivergent < 0)
+            {
+                firstDivergent = frames - 1;
+                divergentTile = tile;
+            }
+        }
+    }
+    // 帧数不同时把剩余的帧全部应用，再比较最终结果
+    framesA = frames + (moreA ? 1 : 0);
+    framesB = frames + (moreB ? 1 : 0);
+    while (moreA && readerA.next(workA, frameA))
+    {
+        framesA++;
+    }
+    while (moreB && readerB.next(workB, frameB))
+    {
+        framesB++;
+    }
+    float finalDiff = 0.0f;
+    for (int tile = 0; tile < workA.tilesX * workA.tilesZ; tile++)
+    {
+        tileDifference(workA, workB, tile, finalDiff);
+    }
+    bool valid = !readerA.failed() && !readerB.failed();
+    bool equal = valid && finalDiff <= tolerance;
+    std::printf("{\"equal\": %s, \"valid\": %s, \"frames\": [%lld, %lld], \"first_divergent_frame\": %lld, \"divergent_tile\": %d, "
+                "\"max_frame_diff\": %.6g, \"final_max_diff\": %.6g, \"min_depth\": [%.6g, %.6g]}\n",
+                equal ? "true" : "false", valid ? "true" : "false", framesA, framesB, firstDivergent, divergentTile, maxFrameDiff, finalDiff,
+                minDepth(workA), minDepth(workB));
+    return equal ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    std::string command = argc > 1 ? argv[1] : "";
+    if (command == "info" && argc >= 3)
+    {
+        return info(argv[2]);
+    }
+    if (command == "compare" && argc >= 4)
+    {
+        float tolerance = 0.0f;
+        for (int i = 4; i + 1 < argc; i += 2)
+        {
+            if (std::string(argv[i]) == "--tolerance")
+                tolerance = float(std::atof(argv[i + 1]));
+        }
+        return compare(argv[2], argv[3], tolerance);
+    }
+    std::cerr << "usage: ZMapDelta info <log.zdl>\n       ZMapDelta compare <a.zdl> <b.zdl> [--tolerance mm]" << std::endl;
+    return 2;
+}
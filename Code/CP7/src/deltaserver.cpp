@@ -0,0 +1,305 @@
+#include "deltaserver.hpp"
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+static const SocketHandle NO_SOCKET = INVALID_SOCKET;
+static void closeSocket(SocketHandle s) { closesocket(s); }
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+static const SocketHandle NO_SOCKET = -1;
+static void closeSocket(SocketHandle s) { ::close(s); }
+#endif
+
+namespace
+{
+#ifdef MSG_NOSIGNAL
+    const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    const int SEND_FLAGS = 0;
+#endif
+
+    // Winsock需要先初始化，其他平台什么也不做
+    bool initSockets()
+    {
+#ifdef _WIN32
+        static bool ok = [] {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        return ok;
+#else
+        return true;
+#endif
+    }
+
+    sockaddr_in loopback(int port)
+    {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(uint16_t(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return address;
+    }
+
+    // 每次从日志取给一个查看器的最大字节数
+    const size_t SEGMENT_BYTES = 1 << 20;
+    // 查看器连接之后追加的日志中尚未发出的部分超过MAX_LAG_BYTES，
+    // 或有数据待发送时超过STALL_TIMEOUT没有收下任何字节，就断开该查看器
+    const size_t MAX_LAG_BYTES = size_t(64) << 20;
+    const auto STALL_TIMEOUT = std::chrono::seconds(5);
+
+    bool setNonBlocking(SocketHandle s)
+    {
+#ifdef _WIN32
+        u_long mode = 1;
+        return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+        int flags = fcntl(s, F_GETFL, 0);
+        return flags != -1 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    // 非阻塞发送因发送缓冲已满而失败
+    bool wouldBlock()
+    {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+    }
+}
+
+DeltaServer::DeltaServer(std::shared_ptr<DeltaLog> log) : log(std::move(log))
+{
+}
+
+DeltaServer::~DeltaServer()
+{
+    stop();
+}
+
+bool DeltaServer::start(int port)
+{
+    if (running || !initSockets())
+    {
+        return false;
+    }
+    SocketHandle s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == NO_SOCKET)
+    {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+    sockaddr_in address = loopback(port);
+    if (bind(s, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(s, 4) != 0)
+    {
+        closeSocket(s);
+        return false;
+    }
+    listener = intptr_t(s);
+    running = true;
+    thread = std::thread(&DeltaServer::run, this);
+    return true;
+}
+
+void DeltaServer::stop()
+{
+    if (!running)
+    {
+        return;
+    }
+    running = false;
+    thread.join();
+    closeSocket(SocketHandle(listener));
+    listener = -1;
+}
+
+void DeltaServer::run()
+{
+    // 各查看器的套接字为非阻塞，未发完的数据留在各自的pending中，慢的查看器不影响其他查看器
+    struct Client
+    {
+        SocketHandle socket;
+        // 连接时日志的长度
+        size_t joined;
+        // 已取入pending的日志位置，pending中前sent个字节已发出
+        size_t offset;
+        std::vector<uint8_t> pending;
+        size_t sent;
+        std::chrono::steady_clock::time_point progress;
+    };
+    std::vector<Client> clients;
+    SocketHandle server = SocketHandle(listener);
+    while (running)
+    {
+        // 等待新连接或可写的查看器，超时后顺便把新追加的日志发给已有连接
+        size_t logSize = log->size();
+        fd_set readable, writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        FD_SET(server, &readable);
+        SocketHandle top = server;
+        for (const Client &client : clients)
+        {
+            if (client.sent < client.pending.size() || client.offset < logSize)
+            {
+                FD_SET(client.socket, &writable);
+                top = std::max(top, client.socket);
+            }
+        }
+        timeval timeout{0, 20000};
+        if (select(int(top + 1), &readable, &writable, nullptr, &timeout) > 0 && FD_ISSET(server, &readable))
+        {
+            SocketHandle s = accept(server, nullptr, nullptr);
+            if (s != NO_SOCKET && setNonBlocking(s))
+            {
+                clients.push_back({s, log->size(), 0, {}, 0, std::chrono::steady_clock::now()});
+            }
+            else if (s != NO_SOCKET)
+            {
+                closeSocket(s);
+            }
+        }
+        logSize = log->size();
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < clients.size();)
+        {
+            Client &client = clients[i];
+            bool alive = true;
+            while (alive)
+            {
+                if (client.sent == client.pending.size())
+                {
+                    client.pending.clear();
+                    client.sent = 0;
+                    client.offset = log->copy(client.offset, client.pending, SEGMENT_BYTES);
+                    if (client.pending.empty())
+                    {
+                        break;
+                    }
+                }
+                int count = int(send(client.socket, reinterpret_cast<const char *>(client.pending.data() + client.sent),
+                                     int(client.pending.size() - client.sent), SEND_FLAGS));
+                if (count > 0)
+                {
+                    client.sent += size_t(count);
+                    client.progress = now;
+                }
+                else if (count < 0 && wouldBlock())
+                {
+                    break;
+                }
+                else
+                {
+                    // 查看器已断开
+                    alive = false;
+                }
+            }
+            size_t delivered = std::max(client.offset - (client.pending.size() - client.sent), client.joined);
+            bool lagging = logSize > delivered && logSize - delivered > MAX_LAG_BYTES;
+            bool stalled = client.sent < client.pending.size() && now - client.progress > STALL_TIMEOUT;
+            if (!alive || lagging || stalled)
+            {
+                closeSocket(client.socket);
+                if (i + 1 < clients.size())
+                {
+                    clients[i] = std::move(clients.back());
+                }
+                clients.pop_back();
+                continue;
+            }
+            i++;
+        }
+        clientCount = int(clients.size());
+    }
+    for (Client &client : clients)
+    {
+        closeSocket(client.socket);
+    }
+    clientCount = 0;
+}
+
+DeltaClient::~DeltaClient()
+{
+    close();
+}
+
+bool DeltaClient::connect(int port)
+{
+    close();
+    if (!initSockets())
+    {
+        return false;
+    }
+    SocketHandle s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == NO_SOCKET)
+    {
+        return false;
+    }
+    sockaddr_in address = loopback(port);
+    if (::connect(s, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        closeSocket(s);
+        return false;
+    }
+    socket = intptr_t(s);
+    connected = true;
+    thread = std::thread(&DeltaClient::run, this);
+    return true;
+}
+
+void DeltaClient::close()
+{
+    if (socket == -1)
+    {
+        return;
+    }
+    // 先关闭发送与接收，让阻塞在recv上的线程返回
+#ifdef _WIN32
+    shutdown(SocketHandle(socket), SD_BOTH);
+#else
+    shutdown(SocketHandle(socket), SHUT_RDWR);
+#endif
+    thread.join();
+    closeSocket(SocketHandle(socket));
+    socket = -1;
+    connected = false;
+}
+
+void DeltaClient::run()
+{
+    std::vector<char> chunk(1 << 16);
+    while (true)
+    {
+        int count = int(recv(SocketHandle(socket), chunk.data(), int(chunk.size()), 0));
+        if (count <= 0)
+        {
+            break;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        received.insert(received.end(), chunk.begin(), chunk.begin() + count);
+    }
+    connected = false;
+}
+
+bool DeltaClient::take(std::vector<uint8_t> &out)
+{
+    bool alive = connected;
+    std::lock_guard<std::mutex> lock(mutex);
+    out.insert(out.end(), received.begin(), received.end());
+    received.clear();
+    return alive;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "deltalog.hpp"
+
+// 通过本机TCP连接把增量日志推送给另一个进程中的查看器
+// 新连接先收到已有的全部日志，之后随仿真持续收到新追加的帧；只监听127.0.0.1
+// 发送不阻塞，跟不上仿真或长时间不接收数据的查看器会被断开
+
+class DeltaServer
+{
+public:
+    explicit DeltaServer(std::shared_ptr<DeltaLog> log);
+    ~DeltaServer();
+
+    // 在后台线程中监听端口，失败时返回false
+    bool start(int port);
+    void stop();
+
+    // 当前连接的查看器数量
+    int clients() const { return clientCount; }
+
+private:
+    std::shared_ptr<DeltaLog> log;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<int> clientCount{0};
+    intptr_t listener = -1;
+
+    void run();
+};
+
+class DeltaClient
+{
+public:
+    ~DeltaClient();
+
+    // 连接本机端口并在后台线程中接收数据
+    bool connect(int port);
+    void close();
+
+    // 取出目前收到的字节，追加到out；连接已断开时返回false（断开前收到的数据仍会取出）
+    bool take(std::vector<uint8_t> &out);
+
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::vector<uint8_t> received;
+    std::atomic<bool> connected{false};
+    intptr_t socket = -1;
+
+    void run();
+};
@@ -0,0 +1,320 @@
+#include "gpuzmap.hpp"
+#include "toolshape.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+GpuZMap::GpuZMap(WorkPiece &mirror, const std::string &shaderDir)
+    : mirror(mirror), shader((shaderDir + "/gpuzmap.vert").c_str(), (shaderDir + "/gpuzmap.frag").c_str())
+{
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (mirror.length > maxSize || mirror.width > maxSize)
+    {
+        throw std::runtime_error("workpiece exceeds GL_MAX_TEXTURE_SIZE");
+    }
+
+    glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, mirror.width, mirror.length, 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, heightTexture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("R32F framebuffer is not supported");
+    }
+
+    // 扫掠体作为实例属性，四个顶点由gl_VertexID生成
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &instanceBuffer);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribDivisor(0, 1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(float), (void *)(4 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glBindVertexArray(0);
+
+    tileDirty.assign(size_t(mirror.tilesX) * mirror.tilesZ, 0);
+    tileStale.assign(tileDirty.size(), 0);
+    upload();
+}
+
+void GpuZMap::upload()
+{
+    pending.clear();
+    hasLast = false;
+    std::fill(tileStale.begin(), tileStale.end(), 0);
+    // 纹理的每一行对应一个x，与WorkPiece中x * width + z的存储顺序一致
+    std::vector<float> heights;
+    const float *data = mirror.depthData.data();
+    if (mirror.format != HeightFormat::Float)
+    {
+        heights.resize(size_t(mirror.length) * mirror.width);
+        for (int x = 0; x < mirror.length; x++)
+        {
+            for (int z = 0; z < mirror.width; z++)
+            {
+                heights[size_t(x) * mirror.width + z] = mirror.getDepth(x, z);
+            }
+        }
+        data = heights.data();
+    }
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mirror.width, mirror.length, GL_RED, GL_FLOAT, data);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GpuZMap::~GpuZMap()
+{
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &heightTexture);
+    glDeleteProgram(shader.ID);
+}
+
+bool GpuZMap::sweep(const Cutter &cutter, glm::vec3 from, glm::vec3 to)
+{
+    // 刀位是刀具采样网格的原点，球心相对它偏移(middleX, middleY, middleZ)，均为网格坐标
+    glm::vec3 middle(cutter.middleX, cutter.middleY, cutter.middleZ);
+    glm::vec3 a = from + middle;
+    glm::vec3 b = to + middle;
+    float radius = cutter.radius;
+
+    // 覆盖的网格范围
+    int x0 = std::max(0, int(std::floor(std::min(a.x, b.x) - radius)));
+    int x1 = std::min(mirror.length, int(std::ceil(std::max(a.x, b.x) + radius)) + 1);
+    int z0 = std::max(0, int(std::floor(std::min(a.z, b.z) - radius)));
+    int z1 = std::min(mirror.width, int(std::ceil(std::max(a.z, b.z) + radius)) + 1);
+    if (x0 >= x1 || z0 >= z1)
+    {
+        return false;
+    }
+    for (int tx = x0 / WorkPiece::TILE_SIZE; tx <= (x1 - 1) / WorkPiece::TILE_SIZE; tx++)
+    {
+        for (int tz = z0 / WorkPiece::TILE_SIZE; tz <= (z1 - 1) / WorkPiece::TILE_SIZE; tz++)
+        {
+            tileDirty[tx * mirror.tilesZ + tz] = 1;
+            tileStale[tx * mirror.tilesZ + tz] = 1;
+        }
+    }
+
+    float instance[7] = {a.x, a.y, a.z, radius, b.x, b.y, b.z};
+    pending.insert(pending.end(), instance, instance + 7);
+    if (pending.size() >= BATCH_SIZE * 7)
+    {
+        flush();
+    }
+    return true;
+}
+
+bool GpuZMap::stampCutter(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis)
+{
+    if (cutter.shape != CutterShape::Ball || !isVerticalAxis(toolAxis))
+    {
+        return stampOnMirror(cutter, toolPosition, toolAxis);
+    }
+    last = toolPosition;
+    hasLast = true;
+    return sweep(cutter, toolPosition, toolPosition);
+}
+
+bool GpuZMap::stampPath(const Cutter &cutter, const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &axes)
+{
+    bool covered = false;
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        glm::vec3 position = positions[i];
+        glm::vec3 axis = axes.empty() ? glm::vec3(0.0f, 1.0f, 0.0f) : axes[i];
+        if (cutter.shape != CutterShape::Ball || !isVerticalAxis(axis))
+        {
+            covered |= stampOnMirror(cutter, position, axis);
+            continue;
+        }
+        covered |= sweep(cutter, hasLast ? last : position, position);
+        last = position;
+        hasLast = true;
+    }
+    return covered;
+}
+
+bool GpuZMap::stampOnMirror(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis)
+{
+    // 之后的扫掠体不从这个刀位连出，否则两刀位之间会按竖直球头刀切削
+    hasLast = false;
+    // 与WorkPiece::stampTool相同的覆盖范围
+    ToolShape tool = makeToolShape(cutter, toolPosition, toolAxis);
+    int x0 = std::max(0, int(std::ceil(tool.lower.x / mirror.precision)));
+    int x1 = std::min(mirror.length, int(std::floor(tool.upper.x / mirror.precision)) + 1);
+    int z0 = std::max(0, int(std::ceil(tool.lower.z / mirror.precision)));
+    int z1 = std::min(mirror.width, int(std::floor(tool.upper.z / mirror.precision)) + 1);
+    if (x0 >= x1 || z0 >= z1)
+    {
+        return false;
+    }
+    std::vector<int> tiles, stale;
+    for (int tx = x0 / WorkPiece::TILE_SIZE; tx <= (x1 - 1) / WorkPiece::TILE_SIZE; tx++)
+    {
+        for (int tz = z0 / WorkPiece::TILE_SIZE; tz <= (z1 - 1) / WorkPiece::TILE_SIZE; tz++)
+        {
+            int tile = tx * mirror.tilesZ + tz;
+            tiles.push_back(tile);
+            if (tileStale[tile])
+            {
+                stale.push_back(tile);
+            }
+        }
+    }
+    // 先让mirror中的这些分块包含GPU上已有的切削结果（download会先提交排队的扫掠体）
+    flush();
+    download(stale);
+    if (!mirror.stampCutter(cutter, toolPosition, toolAxis))
+    {
+        return false;
+    }
+    uploadTiles(tiles);
+    for (int tile : tiles)
+    {
+        tileDirty[tile] = 1;
+    }
+    return true;
+}
+
+void GpuZMap::uploadTiles(const std::vector<int> &tiles)
+{
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int tile : tiles)
+    {
+        int x0, x1, z0, z1;
+        mirror.tileBounds(tile, x0, x1, z0, z1);
+        int columns = z1 - z0;
+        staging.resize(size_t(x1 - x0) * columns);
+        for (int x = x0; x < x1; x++)
+        {
+            for (int z = z0; z < z1; z++)
+            {
+                staging[size_t(x - x0) * columns + (z - z0)] = mirror.getDepth(x, z);
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, z0, x0, columns, x1 - x0, GL_RED, GL_FLOAT, staging.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GpuZMap::flush()
+{
+    if (pending.empty())
+    {
+        return;
+    }
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, mirror.width, mirror.length);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    // GL_MIN忽略混合因子，结果为已有深度与扫掠体底面中较低的一个
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_MIN);
+
+    shader.use();
+    shader.setFloat("Precision", mirror.precision);
+    shader.setFloat("GridZ", float(mirror.width));
+    shader.setFloat("GridX", float(mirror.length));
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, pending.size() * sizeof(float), pending.data(), GL_STREAM_DRAW);
+    GLsizei count = GLsizei(pending.size() / 7);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    glBindVertexArray(0);
+    sweeps += count;
+    pending.clear();
+
+    glBlendEquation(GL_FUNC_ADD);
+    if (!blend)
+        glDisable(GL_BLEND);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+    if (cullFace)
+        glEnable(GL_CULL_FACE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void GpuZMap::download(const std::vector<int> &tiles)
+{
+    flush();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    for (int tile : tiles)
+    {
+        int x0, x1, z0, z1;
+        mirror.tileBounds(tile, x0, x1, z0, z1);
+        int columns = z1 - z0;
+        readback.resize(size_t(x1 - x0) * columns);
+        glReadPixels(z0, x0, columns, x1 - x0, GL_RED, GL_FLOAT, readback.data());
+        for (int x = x0; x < x1; x++)
+        {
+            const float *row = readback.data() + size_t(x - x0) * columns;
+            for (int z = z0; z < z1; z++)
+            {
+                mirror.setDepth(x, z, row[z - z0]);
+            }
+        }
+        mirror.markDirty(x0, x1, z0, z1);
+        tileStale[tile] = 0;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+std::vector<int> GpuZMap::takeDirtyTiles()
+{
+    std::vector<int> tiles;
+    for (size_t i = 0; i < tileDirty.size(); i++)
+    {
+        if (tileDirty[i])
+        {
+            tiles.push_back(int(i));
+            tileDirty[i] = 0;
+        }
+    }
+    return tiles;
+}
+
+void GpuZMap::synchronize()
+{
+    std::vector<int> stale;
+    for (size_t i = 0; i < tileStale.size(); i++)
+    {
+        if (tileStale[i])
+        {
+            stale.push_back(int(i));
+        }
+    }
+    download(stale);
+}
+
+void GpuZMap::buildMesh(std::vector<float> &coords, std::vector<int> &indices)
+{
+    synchronize();
+    mirror.buildMesh(coords, indices);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "stock.hpp"
+#include "workpiece.hpp"
+
+// 在GPU上铣削的Z-map：深度保存在R32F纹理中（纵向为x、横向为z，与WorkPiece的存储顺序相同）
+// 相邻刀位之间球头扫掠出的胶囊体作为一个实例光栅化，片元着色器求出网格点竖直线与胶囊体的最低交点，以GL_MIN混合写入纹理；
+// 只在需要统计、建网格或导出时才把被修改的分块读回CPU上的mirror
+// GPU上只处理竖直刀轴的球头刀（球头部分）；刀轴倾斜或平底刀、牛鼻刀的刀位先读回刀具覆盖的分块，
+// 在mirror上按CPU铣削后再把这些分块上传，几何与WorkPiece的结果一致
+class GpuZMap : public Stock
+{
+public:
+    // 以mirror的尺寸与当前深度创建纹理；当前线程需要有OpenGL 3.3上下文，shaderDir为gpuzmap.vert/frag所在目录
+    GpuZMap(WorkPiece &mirror, const std::string &shaderDir);
+    ~GpuZMap();
+
+    GpuZMap(const GpuZMap &) = delete;
+    GpuZMap &operator=(const GpuZMap &) = delete;
+
+    using Stock::stampCutter;
+
+    // 单个刀位按长度为0的扫掠处理；GPU上无法立即知道是否切除了材料，返回值表示刀具是否覆盖了工件范围
+    bool stampCutter(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis) override;
+
+    // 扫掠相邻刀位之间的胶囊体：连续的调用视为同一条刀路，第一个刀位与上一次调用的最后一个刀位相连；
+    // 在CPU上铣削的刀位与upload之后的第一个刀位不与之前的刀位相连
+    bool stampPath(const Cutter &cutter, const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &axes) override;
+
+    // 扫掠刀位从from到to（网格坐标）的一段，按竖直刀轴的球头刀处理
+    bool sweep(const Cutter &cutter, glm::vec3 from, glm::vec3 to);
+
+    // 把排队的扫掠体提交给GPU
+    void flush();
+
+    // 把给定分块的深度读回mirror，mirror中对应分块被标记为已修改
+    void download(const std::vector<int> &tiles);
+
+    // 把所有尚未同步的分块读回mirror
+    void synchronize();
+
+    // mirror的深度被直接修改后（如重新初始化毛坯）重新上传整个纹理
+    void upload();
+
+    // 取出自上次调用以来被扫掠覆盖的分块
+    std::vector<int> takeDirtyTiles() override;
+
+    // 同步后由mirror生成网格
+    void buildMesh(std::vector<float> &coords, std::vector<int> &indices) override;
+
+    GLuint texture() const { return heightTexture; }
+
+    // 已提交的扫掠体数量
+    long long sweeps = 0;
+
+private:
+    // 一次提交的扫掠体上限
+    static constexpr size_t BATCH_SIZE = 4096;
+
+    WorkPiece &mirror;
+    Shader shader;
+    GLuint heightTexture = 0;
+    GLuint framebuffer = 0;
+    GLuint vao = 0;
+    GLuint instanceBuffer = 0;
+    // 每个扫掠体7个数：起点球心xyz、半径、终点球心xyz（网格坐标）
+    std::vector<float> pending;
+    // 被扫掠覆盖、尚未被takeDirtyTiles取走的分块，以及mirror中尚未同步的分块
+    std::vector<uint8_t> tileDirty;
+    std::vector<uint8_t> tileStale;
+    glm::vec3 last = glm::vec3(0.0f);
+    bool hasLast = false;
+    std::vector<float> readback;
+    std::vector<float> staging;
+
+    // 在mirror上按CPU铣削一个刀位，并把刀具覆盖的分块同步到纹理
+    bool stampOnMirror(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis);
+    // 把mirror中给定分块的深度写入纹理
+    void uploadTiles(const std::vector<int> &tiles);
+};
@@ -0,0 +1,168 @@
+#include "heightao.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+
+HeightAO::HeightAO(const WorkPiece &workpiece, int radius)
+    : length(workpiece.length), width(workpiece.width), tilesX(workpiece.tilesX), tilesZ(workpiece.tilesZ), radius(std::max(radius, 1))
+{
+    halo = (this->radius + WorkPiece::TILE_SIZE - 1) / WorkPiece::TILE_SIZE;
+    // 采样距离由近到远逐渐变稀，近处的小坑与远处的侧壁都能看到
+    std::vector<int> steps;
+    for (int s = 1; s <= this->radius; s = std::max(s + 1, int(s * 1.4f)))
+    {
+        steps.push_back(s);
+    }
+    stepsPerDirection = int(steps.size());
+    for (int d = 0; d < DIRECTIONS; d++)
+    {
+        // 错开半个角度，避免所有方向都落在网格轴线上
+        float angle = (float(d) + 0.5f) * 6.2831853f / DIRECTIONS;
+        for (int s : steps)
+        {
+            glm::ivec2 offset(int(std::lround(std::cos(angle) * s)), int(std::lround(std::sin(angle) * s)));
+            offsets.push_back(offset);
+            distances.push_back(glm::length(glm::vec2(offset)) * workpiece.precision);
+        }
+    }
+
+    size_t tiles = size_t(tilesX) * tilesZ;
+    visibility.assign(size_t(length) * width, 255);
+    queued.assign(tiles, 0);
+    stale.assign(tiles, 0);
+    // 第一次计算全部分块，不受单步上限约束
+    queue.resize(tiles);
+    for (size_t i = 0; i < tiles; i++)
+    {
+        queue[i] = int(i);
+        queued[i] = 1;
+    }
+    update(workpiece, int(tiles));
+}
+
+HeightAO::~HeightAO()
+{
+    if (aoTexture)
+    {
+        glDeleteTextures(1, &aoTexture);
+    }
+}
+
+void HeightAO::invalidate(const std::vector<int> &tiles)
+{
+    for (int tile : tiles)
+    {
+        int tx = tile / tilesZ;
+        int tz = tile % tilesZ;
+        for (int x = std::max(tx - halo, 0); x <= std::min(tx + halo, tilesX - 1); x++)
+        {
+            for (int z = std::max(tz - halo, 0); z <= std::min(tz + halo, tilesZ - 1); z++)
+            {
+                int neighbour = x * tilesZ + z;
+                if (!queued[neighbour])
+                {
+                    queued[neighbour] = 1;
+                    queue.push_back(neighbour);
+                }
+            }
+        }
+    }
+}
+
+int HeightAO::update(const WorkPiece &workpiece, int budget)
+{
+    // 先进先出，刀具持续切削时较早被修改的区域也会轮到
+    int count = std::min(std::max(budget, 0), int(queue.size()));
+    if (count == 0)
+    {
+        return 0;
+    }
+    std::vector<int> work(queue.begin(), queue.begin() + count);
+    queue.erase(queue.begin(), queue.begin() + count);
+    for (int tile : work)
+    {
+        queued[tile] = 0;
+    }
+    parallelFor(count, [&](int i) { computeTile(workpiece, work[i]); });
+    for (int tile : work)
+    {
+        if (!stale[tile])
+        {
+            stale[tile] = 1;
+            computed.push_back(tile);
+        }
+    }
+    return count;
+}
+
+void HeightAO::computeTile(const WorkPiece &workpiece, int tile)
+{
+    int x0, x1, z0, z1;
+    workpiece.tileBounds(tile, x0, x1, z0, z1);
+    for (int x = x0; x < x1; x++)
+    {
+        for (int z = z0; z < z1; z++)
+        {
+            float center = workpiece.getDepth(x, z);
+            float occlusion = 0.0f;
+            for (int d = 0; d < DIRECTIONS; d++)
+            {
+                // 该方向上地平线仰角的正切，低于水平面按水平处理
+                float horizon = 0.0f;
+                for (int s = d * stepsPerDirection; s < (d + 1) * stepsPerDirection; s++)
+                {
+                    int sx = x + offsets[s].x;
+                    int sz = z + offsets[s].y;
+                    // 毛坯以外是空的，不遮挡
+                    if (sx < 0 || sx >= length || sz < 0 || sz >= width)
+                    {
+                        break;
+                    }
+                    horizon = std::max(horizon, (workpiece.getDepth(sx, sz) - center) / distances[s]);
+                }
+                // 仰角的正弦
+                occlusion += horizon / std::sqrt(1.0f + horizon * horizon);
+            }
+            float open = 1.0f - occlusion / DIRECTIONS;
+            visibility[size_t(x) * width + z] = uint8_t(std::lround(std::clamp(open, 0.0f, 1.0f) * 255.0f));
+        }
+    }
+}
+
+void HeightAO::upload()
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (!aoTexture)
+    {
+        // 纹理的每一行对应一个x，与深度的存储顺序一致
+        glGenTextures(1, &aoTexture);
+        glBindTexture(GL_TEXTURE_2D, aoTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, length, 0, GL_RED, GL_UNSIGNED_BYTE, visibility.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    else
+    {
+        // 只上传计算过的分块，以行长度跳过分块以外的数据
+        glBindTexture(GL_TEXTURE_2D, aoTexture);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+        for (int tile : computed)
+        {
+            int x0 = tile / tilesZ * WorkPiece::TILE_SIZE;
+            int z0 = tile % tilesZ * WorkPiece::TILE_SIZE;
+            int x1 = std::min(x0 + WorkPiece::TILE_SIZE, length);
+            int z1 = std::min(z0 + WorkPiece::TILE_SIZE, width);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, z0, x0, z1 - z0, x1 - x0, GL_RED, GL_UNSIGNED_BYTE, &visibility[size_t(x0) * width + z0]);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    for (int tile : computed)
+    {
+        stale[tile] = 0;
+    }
+    computed.clear();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "workpiece.hpp"
+
+// Z-map的高度场环境光遮蔽（horizon-based AO）
+// 每个网格点沿若干方向搜索地平线仰角，遮蔽值按网格点保存（与深度的存储顺序相同），并上传为纹理供workpieceshader.frag采样；
+// 深度被修改后只把受影响的分块加入队列，每次update最多重新计算budget个分块，剩余的留到之后的步骤，
+// 单步的开销有上限，不需要每帧做屏幕空间AO
+class HeightAO
+{
+public:
+    // 方向数
+    static constexpr int DIRECTIONS = 8;
+
+    // 以workpiece当前的深度计算全部分块；radius为搜索半径（网格数）
+    HeightAO(const WorkPiece &workpiece, int radius = 24);
+    ~HeightAO();
+
+    HeightAO(const HeightAO &) = delete;
+    HeightAO &operator=(const HeightAO &) = delete;
+
+    // 深度被修改的分块；搜索半径内的相邻分块一并加入队列
+    void invalidate(const std::vector<int> &tiles);
+
+    // 重新计算队列中最多budget个分块（并行），返回本次计算的分块数
+    int update(const WorkPiece &workpiece, int budget);
+
+    // 队列中尚未计算的分块数
+    int pendingTiles() const { return int(queue.size()); }
+
+    // 网格点(x, z)的可见度，0为完全遮蔽、255为完全开阔
+    uint8_t value(int x, int z) const { return visibility[size_t(x) * width + z]; }
+
+    // 把计算过的分块上传到纹理（R8，纵向为x、横向为z）；第一次调用时创建纹理，需要OpenGL上下文
+    void upload();
+
+    GLuint texture() const { return aoTexture; }
+
+private:
+    int length;
+    int width;
+    int tilesX;
+    int tilesZ;
+    int radius;
+    // 搜索半径所跨的分块数
+    int halo;
+    // 各方向上的采样偏移（网格）与水平距离（毫米），按方向依次存放
+    std::vector<glm::ivec2> offsets;
+    std::vector<float> distances;
+    int stepsPerDirection = 0;
+    std::vector<uint8_t> visibility;
+    std::vector<int> queue;
+    std::vector<uint8_t> queued;
+    // 已计算但尚未上传的分块
+    std::vector<int> computed;
+    std::vector<uint8_t> stale;
+    GLuint aoTexture = 0;
+
+    void computeTile(const WorkPiece &workpiece, int tile);
+};
@@ -0,0 +1,336 @@
+#include "meshstock.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+static bool readFile(const std::string &path, std::string &content)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+static bool parseBinarySTL(const std::string &data, TriangleMesh &mesh)
+{
+    if (data.size() < 84)
+    {
+        return false;
+    }
+    uint32_t count;
+    std::memcpy(&count, data.data() + 80, sizeof(count));
+    if (data.size() != 84 + size_t(count) * 50)
+    {
+        return false;
+    }
+    mesh.vertices.resize(size_t(count) * 3);
+    // 每个三角形50字节：法线12字节、三个顶点各12字节、属性2字节
+    for (size_t i = 0; i < count; i++)
+    {
+        const char *record = data.data() + 84 + i * 50;
+        for (int k = 0; k < 3; k++)
+        {
+            float xyz[3];
+            std::memcpy(xyz, record + 12 + k * 12, sizeof(xyz));
+            mesh.vertices[i * 3 + k] = glm::vec3(xyz[0], xyz[1], xyz[2]);
+        }
+    }
+    return true;
+}
+
+static void parseAsciiSTL(const std::string &data, TriangleMesh &mesh)
+{
+    const char *cursor = data.c_str();
+    while ((cursor = std::strstr(cursor, "vertex")) != nullptr)
+    {
+        cursor += 6;
+        char *end;
+        glm::vec3 v;
+        v.x = std::strtof(cursor, &end);
+        v.y = std::strtof(end, &end);
+        v.z = std::strtof(end, &end);
+        cursor = end;
+        mesh.vertices.push_back(v);
+    }
+    mesh.vertices.resize(mesh.vertices.size() / 3 * 3);
+}
+
+static void parseOBJ(const std::string &data, TriangleMesh &mesh)
+{
+    std::vector<glm::vec3> positions;
+    std::vector<int> face;
+    const char *cursor = data.c_str();
+    const char *finish = cursor + data.size();
+    while (cursor < finish)
+    {
+        const char *lineEnd = static_cast<const char *>(std::memchr(cursor, '\n', finish - cursor));
+        if (lineEnd == nullptr)
+        {
+            lineEnd = finish;
+        }
+        if (cursor[0] == 'v' && cursor[1] == ' ')
+        {
+            char *end;
+            glm::vec3 v;
+            v.x = std::strtof(cursor + 2, &end);
+            v.y = std::strtof(end, &end);
+            v.z = std::strtof(end, &end);
+            positions.push_back(v);
+        }
+        else if (cursor[0] == 'f' && cursor[1] == ' ')
+        {
+            // 只取每个角点的顶点下标，多边形按扇形三角化，负下标表示相对位置
+            face.clear();
+            const char *token = cursor + 2;
+            while (token < lineEnd)
+            {
+                char *end;
+                long index = std::strtol(token, &end, 10);
+                if (end == token)
+                {
+                    break;
+                }
+                face.push_back(index < 0 ? int(positions.size() + index) : int(index - 1));
+                token = end;
+                while (token < lineEnd && *token != ' ' && *token != '\t')
+                {
+                    token++;
+                }
+            }
+            for (size_t k = 2; k < face.size(); k++)
+            {
+                int corners[3] = {face[0], face[k - 1], face[k]};
+                for (int c : corners)
+                {
+                    mesh.vertices.push_back(c >= 0 && c < int(positions.size()) ? positions[c] : glm::vec3(0.0f));
+                }
+            }
+        }
+        cursor = lineEnd + 1;
+    }
+}
+
+bool loadTriangleMesh(const std::string &path, TriangleMesh &mesh)
+{
+    std::string data;
+    if (!readFile(path, data))
+    {
+        std::cerr << "Failed to open mesh file: " << path << std::endl;
+        return false;
+    }
+    mesh.vertices.clear();
+
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == "obj")
+    {
+        parseOBJ(data, mesh);
+    }
+    else if (!parseBinarySTL(data, mesh))
+    {
+        parseAsciiSTL(data, mesh);
+    }
+
+    if (mesh.vertices.empty())
+    {
+        std::cerr << "No triangles found in mesh file: " << path << std::endl;
+        return false;
+    }
+    std::cout << "Stock mesh loaded: " << mesh.triangleCount() << " triangles" << std::endl;
+    return true;
+}
+
+void meshBounds(const TriangleMesh &mesh, glm::vec3 &lower, glm::vec3 &upper)
+{
+    lower = glm::vec3(std::numeric_limits<float>::max());
+    upper = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const auto &v : mesh.vertices)
+    {
+        lower = glm::min(lower, v);
+        upper = glm::max(upper, v);
+    }
+}
+
+glm::vec3 fitMeshOffset(const TriangleMesh &mesh, const WorkPiece &workpiece)
+{
+    glm::vec3 lower, upper;
+    meshBounds(mesh, lower, upper);
+    glm::vec3 center = (lower + upper) * 0.5f;
+    return glm::vec3((workpiece.length - 1) * workpiece.precision * 0.5f - center.x, -upper.y,
+                     (workpiece.width - 1) * workpiece.precision * 0.5f - center.z);
+}
+
+// 在分块行[x0, x1)内光栅化一个三角形（网格坐标），band按行存放该分块行的最高点
+static void rasterizeTriangle(const glm::vec3 *tri, int x0, int x1, int width, std::vector<float> &band)
+{
+    glm::vec3 normal = glm::cross(tri[1] - tri[0], tri[2] - tri[0]);
+    // 接近竖直（法线与水平面的夹角很小）的三角形对顶面没有贡献，它的边由相邻三角形覆盖
+    if (std::fabs(normal.y) < 1e-6f * glm::length(normal))
+    {
+        return;
+    }
+    float dydx = -normal.x / normal.y;
+    float dydz = -normal.z / normal.y;
+    // 平面方程在顶点以外的外推可能因斜率很大而越界，写入的高度限制在三角形的高度范围内
+    float minY = std::min({tri[0].y, tri[1].y, tri[2].y});
+    float maxY = std::max({tri[0].y, tri[1].y, tri[2].y});
+
+    float minX = std::min({tri[0].x, tri[1].x, tri[2].x});
+    float maxX = std::max({tri[0].x, tri[1].x, tri[2].x});
+    int rowBegin = std::max(x0, int(std::ceil(minX)));
+    int rowEnd = std::min(x1 - 1, int(std::floor(maxX)));
+    for (int x = rowBegin; x <= rowEnd; x++)
+    {
+        // 求该行与三角形三条边的交点，得到z方向的覆盖区间
+        float zLow = std::numeric_limits<float>::max();
+        float zHigh = std::numeric_limits<float>::lowest();
+        for (int e = 0; e < 3; e++)
+        {
+            const glm::vec3 &p = tri[e];
+            const glm::vec3 &q = tri[(e + 1) % 3];
+            if ((p.x - x) * (q.x - x) > 0.0f)
+            {
+                continue;
+            }
+            if (p.x == q.x)
+            {
+                zLow = std::min({zLow, p.z, q.z});
+                zHigh = std::max({zHigh, p.z, q.z});
+            }
+            else
+            {
+                float z = p.z + (float(x) - p.x) / (q.x - p.x) * (q.z - p.z);
+                zLow = std::min(zLow, z);
+                zHigh = std::max(zHigh, z);
+            }
+        }
+        int zBegin = std::max(0, int(std::ceil(zLow)));
+        int zEnd = std::min(width - 1, int(std::floor(zHigh)));
+        float *row = &band[size_t(x - x0) * width];
+        float rowHeight = tri[0].y + dydx * (float(x) - tri[0].x) - dydz * tri[0].z;
+        for (int z = zBegin; z <= zEnd; z++)
+        {
+            row[z] = std::max(row[z], glm::clamp(rowHeight + dydz * float(z), minY, maxY));
+        }
+    }
+}
+
+void initWorkpieceFromMesh(WorkPiece &workpiece, const TriangleMesh &mesh, glm::vec3 offset, float floorDepth)
+{
+    // 定点格式先按浮点光栅化，最后统一转换，避免逐点调整分块基准
+    HeightFormat format = workpiece.format;
+    if (format != HeightFormat::Float)
+    {
+        workpiece.setFormat(HeightFormat::Float);
+    }
+
+    const int tile = WorkPiece::TILE_SIZE;
+    const int bands = workpiece.tilesX;
+    const int triangleCount = int(mesh.triangleCount());
+    const float scale = 1.0f / workpiece.precision;
+
+    // 顶点变换到网格坐标：x、z以网格为单位，y保持毫米
+    std::vector<glm::vec3> grid(mesh.vertices.size());
+    std::vector<int> bandRange(size_t(triangleCount) * 2);
+    const int chunkSize = 16384;
+    const int chunks = (triangleCount + chunkSize - 1) / chunkSize;
+    std::vector<int> counts(size_t(chunks) * bands, 0);
+    parallelFor(chunks, [&](int chunk) {
+        int begin = chunk * chunkSize;
+        int end = std::min(begin + chunkSize, triangleCount);
+        int *chunkCounts = &counts[size_t(chunk) * bands];
+        for (int t = begin; t < end; t++)
+        {
+            float minX = std::numeric_limits<float>::max();
+            float maxX = std::numeric_limits<float>::lowest();
+            for (int k = 0; k < 3; k++)
+            {
+                glm::vec3 v = mesh.vertices[size_t(t) * 3 + k] + offset;
+                grid[size_t(t) * 3 + k] = glm::vec3(v.x * scale, v.y, v.z * scale);
+                minX = std::min(minX, v.x * scale);
+                maxX = std::max(maxX, v.x * scale);
+            }
+            // 三角形覆盖的分块行范围，完全在工件外时为空区间
+            int first = std::max(0, int(std::ceil(minX)) / tile);
+            int last = std::min(bands - 1, int(std::floor(std::min(maxX, float(workpiece.length - 1)))) / tile);
+            if (maxX < 0.0f || minX > float(workpiece.length - 1))
+            {
+                first = 1;
+                last = 0;
+            }
+            bandRange[size_t(t) * 2] = first;
+            bandRange[size_t(t) * 2 + 1] = last;
+            for (int b = first; b <= last; b++)
+            {
+                chunkCounts[b]++;
+            }
+        }
+    });
+
+    // 计数排序：每个分块行内按数据块顺序排列，各数据块可以并行写入各自的位置
+    std::vector<size_t> bandStart(size_t(bands) + 1, 0);
+    std::vector<size_t> cursor(size_t(chunks) * bands);
+    size_t total = 0;
+    for (int b = 0; b < bands; b++)
+    {
+        bandStart[b] = total;
+        for (int chunk = 0; chunk < chunks; chunk++)
+        {
+            cursor[size_t(chunk) * bands + b] = total;
+            total += counts[size_t(chunk) * bands + b];
+        }
+    }
+    bandStart[bands] = total;
+    std::vector<int> binned(total);
+    parallelFor(chunks, [&](int chunk) {
+        int begin = chunk * chunkSize;
+        int end = std::min(begin + chunkSize, triangleCount);
+        size_t *chunkCursor = &cursor[size_t(chunk) * bands];
+        for (int t = begin; t < end; t++)
+        {
+            for (int b = bandRange[size_t(t) * 2]; b <= bandRange[size_t(t) * 2 + 1]; b++)
+            {
+                binned[chunkCursor[b]++] = t;
+            }
+        }
+    });
+
+    // 每个分块行独立光栅化后写回工件
+    const int width = workpiece.width;
+    parallelFor(bands, [&](int b) {
+        int x0 = b * tile;
+        int x1 = std::min(x0 + tile, workpiece.length);
+        std::vector<float> band(size_t(x1 - x0) * width, std::numeric_limits<float>::lowest());
+        for (size_t i = bandStart[b]; i < bandStart[b + 1]; i++)
+        {
+            rasterizeTriangle(&grid[size_t(binned[i]) * 3], x0, x1, width, band);
+        }
+        for (int x = x0; x < x1; x++)
+        {
+            const float *row = &band[size_t(x - x0) * width];
+            float *depth = &workpiece.depthData[size_t(x) * width];
+            for (int z = 0; z < width; z++)
+            {
+                depth[z] = row[z] == std::numeric_limits<float>::lowest() ? floorDepth : row[z];
+            }
+        }
+    });
+
+    workpiece.markDirty(0, workpiece.length, 0, workpiece.width);
+    if (format != HeightFormat::Float)
+    {
+        workpiece.setFormat(format);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "workpiece.hpp"
+
+// 三角形网格（三角形汤），每连续三个顶点构成一个三角形
+struct TriangleMesh
+{
+    std::vector<glm::vec3> vertices;
+
+    size_t triangleCount() const
+    {
+        return vertices.size() / 3;
+    }
+};
+
+// 读取STL（二进制或ASCII）或OBJ文件中的三角形，失败返回false
+bool loadTriangleMesh(const std::string &path, TriangleMesh &mesh);
+
+// 网格的包围盒
+void meshBounds(const TriangleMesh &mesh, glm::vec3 &lower, glm::vec3 &upper);
+
+// 计算把网格放到工件上的平移量：xz方向居中，网格最高点与深度0对齐
+glm::vec3 fitMeshOffset(const TriangleMesh &mesh, const WorkPiece &workpiece);
+
+// 将网格平移offset后自上而下光栅化到工件的Z-map中，每个网格点取覆盖它的三角形的最高点，
+// 未被网格覆盖的网格点设为floorDepth；三角形按分块行分桶后由多个线程并行光栅化
+void initWorkpieceFromMesh(WorkPiece &workpiece, const TriangleMesh &mesh, glm::vec3 offset, float floorDepth);
@@ -0,0 +1,66 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// 可用的工作线程数
+inline int workerCount()
+{
+    return std::max(1, int(std::thread::hardware_concurrency()));
+}
+
+// 当前线程调用parallelFor时最多使用的线程数，0表示不限制；
+// 批量调度的工作线程设为1，避免作业内部再创建线程造成过度订阅
+inline int &threadLimit()
+{
+    thread_local int limit = 0;
+    return limit;
+}
+
+// 在[0, count)上并行执行fn(i)，各线程每次领取grain个下标以平衡负载
+template <typename Func>
+void parallelFor(int count, Func &&fn, int grain = 1)
+{
+    grain = std::max(grain, 1);
+    int threads = std::min(workerCount(), (count + grain - 1) / grain);
+    if (threadLimit() > 0)
+    {
+        threads = std::min(threads, threadLimit());
+    }
+    if (threads <= 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (;;)
+        {
+            int begin = next.fetch_add(grain);
+            if (begin >= count)
+            {
+                break;
+            }
+            int end = std::min(begin + grain, count);
+            for (int i = begin; i < end; i++)
+            {
+                fn(i);
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool)
+    {
+        thread.join();
+    }
+}
@@ -0,0 +1,121 @@
+#include "player.hpp"
+#include "workpiece.hpp"
+#include <algorithm>
+#include <chrono>
+
+void updateZmap(WorkPiece &workpiece, Cutter &cutter, Toolpath myPath, glm::vec3 &toolPosition)
+{
+    for (int m = 0; m < myPath.length; m++)
+    {
+        workpiece.stampCutter(cutter, toolPosition + myPath.direction * float(m));
+    }
+    toolPosition = toolPosition + glm::vec3(myPath.direction.x * myPath.length, myPath.direction.y * myPath.length, myPath.direction.z * myPath.length);
+}
+
+void PathPlayer::nextSegment()
+{
+    const Toolpath &path = program[segment];
+    segmentStart = segmentStart + path.direction * float(path.length);
+    segmentAxis = glm::normalize(path.axis);
+    segment++;
+    progress = 0.0f;
+    nextStamp = 0;
+}
+
+glm::vec3 PathPlayer::getPosition() const
+{
+    if (finished())
+    {
+        return segmentStart;
+    }
+    return segmentStart + program[segment].direction * progress;
+}
+
+glm::vec3 PathPlayer::axisAt(float step) const
+{
+    const Toolpath &path = program[segment];
+    glm::vec3 axis = glm::mix(segmentAxis, glm::normalize(path.axis), path.length > 0 ? step / float(path.length) : 1.0f);
+    // 首尾刀轴方向相反时插值会经过零向量，此时直接使用本段的刀轴
+    return glm::length(axis) > 1e-6f ? glm::normalize(axis) : glm::normalize(path.axis);
+}
+
+glm::vec3 PathPlayer::getAxis() const
+{
+    return finished() ? segmentAxis : axisAt(progress);
+}
+
+bool PathPlayer::advance(Stock &stock, const Cutter &cutter, double dt)
+{
+    using Clock = std::chrono::steady_clock;
+    auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(frameBudget));
+
+    if (!finished())
+    {
+        pendingTime += double(speedMultiplier) * dt;
+    }
+
+    bool changed = false;
+    while (!finished() && pendingTime > 0.0)
+    {
+        const Toolpath &path = program[segment];
+        // 每一步对应的实际移动距离（mm）与耗时（秒）
+        float stepLength = glm::length(path.direction) * cutter.precision;
+        if (path.length <= 0 || stepLength <= 0.0f)
+        {
+            nextSegment();
+            continue;
+        }
+        float feed = path.feed > 0.0f ? path.feed : feedRate;
+        double stepTime = stepLength / (feed / 60.0);
+
+        // 把本帧可用的时间换算成在本段内可到达的位置
+        float target = std::min(float(path.length), progress + float(pendingTime / stepTime));
+
+        // 铣削(progress, target]之间的所有采样点，超出预算则停在已铣削的位置
+        bool outOfBudget = false;
+        while (nextStamp < path.length && float(nextStamp) <= target)
+        {
+            // 每批最多8个刀位，每批之后检查一次时钟，避免频繁取时间
+            batch.clear();
+            batchAxes.clear();
+            while (batch.size() < 8 && nextStamp < path.length && float(nextStamp) <= target)
+            {
+                batch.push_back(segmentStart + path.direction * float(nextStamp));
+                batchAxes.push_back(axisAt(float(nextStamp)));
+                nextStamp++;
+            }
+            changed |= stock.stampPath(cutter, batch, batchAxes);
+            if (Clock::now() > deadline)
+            {
+                outOfBudget = true;
+                target = std::min(target, float(nextStamp - 1));
+                break;
+            }
+        }
+
+        if (outOfBudget)
+        {
+            pendingTime -= (target - progress) * stepTime;
+            progress = target;
+            break;
+        }
+        if (target < float(path.length))
+        {
+            // 剩余时间在本段内用完
+            pendingTime = 0.0;
+            progress = target;
+        }
+        else
+        {
+            pendingTime -= (float(path.length) - progress) * stepTime;
+            nextSegment();
+            if (finished())
+            {
+                // 刀路终点也铣削一次，保证最后一段完整
+                changed |= stock.stampCutter(cutter, segmentStart, segmentAxis);
+                pendingTime = 0.0;
+            }
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "stock.hpp"
+#include "cutter.hpp"
+
+//方向、移动距离、进给速度（mm/min，0表示使用回放器的默认进给）、段终点的刀轴方向
+//刀轴在一段内从上一段终点的刀轴线性过渡到本段的刀轴，与五轴程序的直线插补一致
+struct Toolpath{
+    glm::vec3 direction;
+    int length;
+    float feed = 0.0f;
+    glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f);
+};
+
+class WorkPiece;
+
+// 沿一段刀路逐步用竖直刀轴铣削工件（不按进给计时），toolPosition移动到段终点
+void updateZmap(WorkPiece &workpiece, Cutter &cutter, Toolpath myPath, glm::vec3 &toolPosition);
+
+// 按进给速度连续回放刀路的仿真时钟
+// 刀具沿每段刀路匀速移动，毛坯在每段刀路上固定的采样点处被铣削，
+// 因此铣削结果与帧率、倍速无关；每帧的铣削耗时受预算限制，超出部分留到后续帧追赶
+class PathPlayer
+{
+public:
+    // 默认进给速度（mm/min）
+    float feedRate;
+    // 回放倍速
+    float speedMultiplier = 1.0f;
+    // 每帧用于铣削的时间预算（秒）
+    double frameBudget = 0.008;
+
+    PathPlayer(const std::vector<Toolpath> &path, glm::vec3 startPosition, float feed)
+        : feedRate(feed), program(path), segmentStart(startPosition) {}
+
+    // 推进仿真时钟dt秒，并把毛坯铣削到新的插值刀位；返回毛坯是否发生变化
+    bool advance(Stock &stock, const Cutter &cutter, double dt);
+
+    // 当前刀位（网格坐标），即已经铣削到的位置
+    glm::vec3 getPosition() const;
+
+    // 当前刀轴方向（单位向量）
+    glm::vec3 getAxis() const;
+
+    // 尚未仿真完的刀路时间（秒），大于0表示正在追赶
+    double getBacklog() const { return pendingTime; }
+
+    bool finished() const { return segment >= program.size(); }
+
+private:
+    std::vector<Toolpath> program;
+    size_t segment = 0;
+    // 当前段的起点（网格坐标）与起点处的刀轴
+    glm::vec3 segmentStart;
+    glm::vec3 segmentAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+    // 当前段内已走过的步数（连续值，范围[0, length]）
+    float progress = 0.0f;
+    // 当前段内下一个待铣削的采样点
+    int nextStamp = 0;
+    double pendingTime = 0.0;
+    // 一次提交给毛坯的刀位
+    std::vector<glm::vec3> batch;
+    std::vector<glm::vec3> batchAxes;
+
+    // 进入下一段刀路
+    void nextSegment();
+    // 当前段内第step步处的刀轴
+    glm::vec3 axisAt(float step) const;
+};
@@ -1,21 +1,38 @@
 #include "camera.hpp"
 #include "cutter.hpp"
+#include "deltalog.hpp"
+#include "deltaserver.hpp"
+#include "heightao.hpp"
+#include "gpuzmap.hpp"
+#include "meshstock.hpp"
+#include "player.hpp"
 #include "shader.hpp"
+#include "shadowmap.hpp"
+#include "stlexport.hpp"
+#include "stockstats.hpp"
 #include "tool.hpp"
+#include "tridexel.hpp"
 #include "workpiece.hpp"
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
+#include <imgui.h>
+#include <imgui_impl_glfw.h>
+#include <imgui_impl_opengl3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
 
 // 定义ASSETS_PATH宏（如果CMakeLists.txt中没有定义的话）
 #ifndef ASSETS_PATH
 #define ASSETS_PATH "src/shaders/"
 #endif
 glm::vec3 toolPoisiton = glm::vec3(10.0, 0.0, 10.0);
-int main()
+int main(int argc, char **argv)
 {
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -36,6 +53,7 @@ int main()
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -51,17 +69,165 @@ int main()
     glCullFace(GL_BACK);
     glLineWidth(2.0f);
     // 初始化工件，并用一个二元函数初始化其数值
-    // 长度、宽度与精度
-    WorkPiece workpiece(200, 200, 0.2);
+    // 长度、宽度与精度，可选HeightFormat::Fixed32/Fixed16以定点整数存储深度
+    WorkPiece workpiece(200, 200, 0.2, HeightFormat::Float);
     initWorkpieceData(workpiece);
+    // 毛坯底面高度，导出STL时使用
+    float stockBottom = -10.0f;
+    // 命令行参数：--tridexel使用三向dexel毛坯进行仿真，其余参数为作为毛坯的STL/OBJ网格（如铸件、半成品）
+    // --record <file>把仿真过程写成增量日志，--serve <port>同时通过本机端口推送给查看器；
+    // --replay <file>回放增量日志，--connect <port>查看另一个进程推送的日志，这两种模式下不进行仿真
+    // --gpu在GPU上铣削Z-map，结果定时读回用于显示；刀轴倾斜或非球头刀的刀位读回相关分块后在CPU上铣削
+    bool useTriDexel = false;
+    bool useGpu = false;
+    std::string stockPath;
+    std::string recordPath;
+    std::string replayPath;
+    int servePort = 0;
+    int connectPort = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--tridexel")
+            useTriDexel = true;
+        else if (arg == "--gpu")
+            useGpu = true;
+        else if (arg == "--record" && hasValue)
+            recordPath = argv[++i];
+        else if (arg == "--serve" && hasValue)
+            servePort = std::atoi(argv[++i]);
+        else if (arg == "--replay" && hasValue)
+            replayPath = argv[++i];
+        else if (arg == "--connect" && hasValue)
+            connectPort = std::atoi(argv[++i]);
+        else
+            stockPath = argv[i];
+    }
+    // 查看模式：工件尺寸与初始形状都来自日志
+    bool isViewer = !replayPath.empty() || connectPort > 0;
+    DeltaReader deltaReader;
+    DeltaClient deltaClient;
+    std::vector<uint8_t> received;
+    if (isViewer)
+    {
+        useTriDexel = false;
+        useGpu = false;
+        stockPath.clear();
+        bool ok = false;
+        if (!replayPath.empty())
+        {
+            ok = loadDeltaFile(replayPath, deltaReader);
+        }
+        else if (deltaClient.connect(connectPort))
+        {
+            // 等待文件头到达
+            for (int wait = 0; wait < 500 && !ok; wait++)
+            {
+                bool alive = deltaClient.take(received);
+                deltaReader.feed(received.data(), received.size());
+                received.clear();
+                ok = deltaReader.readHeader();
+                if (!ok && !alive)
+                    break;
+                if (!ok)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        if (!ok)
+        {
+            throw std::runtime_error("failed to open delta log");
+        }
+        const DeltaHeader &head = deltaReader.header();
+        workpiece = WorkPiece(head.length, head.width, head.precision, HeightFormat::Float, head.heightUnit);
+    }
+    if (!stockPath.empty())
+    {
+        TriangleMesh stockMesh;
+        if (loadTriangleMesh(stockPath, stockMesh))
+        {
+            glm::vec3 lower, upper;
+            meshBounds(stockMesh, lower, upper);
+            glm::vec3 offset = fitMeshOffset(stockMesh, workpiece);
+            stockBottom = lower.y + offset.y;
+            initWorkpieceFromMesh(workpiece, stockMesh, offset, stockBottom);
+        }
+    }
     workpiece.depthToCoords();
     workpiece.generateIndices();
     workpiece.generateLineIndices();
+    // 三向dexel毛坯由Z-map的初始形状生成，之后的铣削只作用于它
+    std::unique_ptr<TriDexel> dexel;
+    std::vector<float> dexelCoords;
+    std::vector<int> dexelIndices;
+    if (useTriDexel)
+    {
+        dexel = std::make_unique<TriDexel>(workpiece.length, workpiece.width, workpiece.precision, stockBottom, 0.0f);
+        dexel->initFromWorkpiece(workpiece);
+        // 初始网格已包含所有分块
+        dexel->takeDirtyTiles();
+        dexel->buildMesh(dexelCoords, dexelIndices);
+    }
+    // GPU铣削以Z-map为读回目标，与三向dexel互斥
+    std::unique_ptr<GpuZMap> gpuZMap;
+    if (useGpu && !useTriDexel)
+    {
+        gpuZMap = std::make_unique<GpuZMap>(workpiece, ASSETS_PATH);
+    }
+    // 距上次读回GPU深度的时间（秒）
+    float readbackTimer = 0.0f;
+    Stock &stock = useTriDexel ? static_cast<Stock &>(*dexel) : gpuZMap ? static_cast<Stock &>(*gpuZMap) : workpiece;
 
     // 初始化刀具
     Cutter myCutter(6, 0.2, 6.0, 4.0, 6.0, toolPoisiton);
     myCutter.generateLowerHemisphere();
     myCutter.samplingBall();
+    myCutter.quantizeProfile(workpiece.heightUnit);
+
+    // 初始化刀路回放器，进给速度单位为mm/min
+    glm::vec3 startPosition = toolPoisiton;
+    PathPlayer player(myPath, startPosition, 150.0f);
+
+    // 增量日志只记录Z-map毛坯
+    std::unique_ptr<DeltaWriter> deltaWriter;
+    std::shared_ptr<DeltaLog> deltaLog;
+    std::unique_ptr<DeltaServer> deltaServer;
+    if ((!recordPath.empty() || servePort > 0) && (useTriDexel || gpuZMap || isViewer))
+    {
+        std::cout << "Delta logging is only available when simulating the Z-map stock" << std::endl;
+    }
+    else if (!recordPath.empty() || servePort > 0)
+    {
+        if (servePort > 0)
+        {
+            deltaLog = std::make_shared<DeltaLog>();
+            deltaServer = std::make_unique<DeltaServer>(deltaLog);
+            if (!deltaServer->start(servePort))
+            {
+                std::cout << "Cannot listen on port " << servePort << std::endl;
+            }
+        }
+        deltaWriter = std::make_unique<DeltaWriter>(workpiece, recordPath, deltaLog);
+    }
+    // 仿真时间与回放时钟（秒）
+    double simulationTime = 0.0;
+    double replayClock = 0.0;
+    bool streamOpen = connectPort > 0;
+    DeltaFrame deltaFrame;
+
+    // 刀具模型绕球头中心转到刀轴方向，并移动到刀位
+    auto placeCutter = [&](glm::vec3 position, glm::vec3 axis) {
+        toolPoisiton = position;
+        glm::vec3 pivot = (startPosition + glm::vec3(myCutter.middleX, myCutter.middleY, myCutter.middleZ)) * myCutter.precision;
+        glm::vec3 hinge = glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), axis);
+        glm::mat4 tilt(1.0f);
+        if (glm::length(hinge) > 1e-6f)
+        {
+            tilt = glm::rotate(tilt, std::acos(glm::clamp(axis.y, -1.0f, 1.0f)), glm::normalize(hinge));
+        }
+        cutterModelMatrix = glm::translate(glm::mat4(1.0f), (toolPoisiton - startPosition) * myCutter.precision + pivot) * tilt *
+                            glm::translate(glm::mat4(1.0f), -pivot);
+    };
 
     // 读取着色器文件，并生成着色器程序
     std::string wpvertShaderPath = std::string(ASSETS_PATH) + "/workpieceshader.vert";
@@ -85,8 +251,68 @@ int main()
         glGenBuffers(1, &cutterGL[i]);
     }
     initWorkPieceRenderdata(workGL, workpiece);
+    if (useTriDexel)
+    {
+        initMeshRenderdata(workGL, dexelCoords, dexelIndices);
+    }
     initCutterRenderdata(cutterGL, myCutter);
 
+    // 剩余体积与已加工面积按被修改的分块增量统计，只用于Z-map毛坯
+    std::unique_ptr<StockStats> stockStats;
+    if (!useTriDexel)
+    {
+        stockStats = std::make_unique<StockStats>(workpiece, stockBottom);
+    }
+    // 高度场环境光遮蔽，被修改的分块排队重算，每帧最多计算aoTileBudget个分块
+    std::unique_ptr<HeightAO> heightAO;
+    const int aoTileBudget = 16;
+    if (!useTriDexel)
+    {
+        heightAO = std::make_unique<HeightAO>(workpiece);
+        heightAO->upload();
+    }
+    // 平行光阴影：工件阴影图缓存，只重画被修改分块覆盖的区域；刀具阴影每帧只重画刀具覆盖的区域
+    glm::vec3 cutterLower(1e30f), cutterUpper(-1e30f);
+    for (size_t i = 0; i + 2 < myCutter.ballCoords.size(); i += 3)
+    {
+        glm::vec3 p(myCutter.ballCoords[i], myCutter.ballCoords[i + 1], myCutter.ballCoords[i + 2]);
+        cutterLower = glm::min(cutterLower, p);
+        cutterUpper = glm::max(cutterUpper, p);
+    }
+    float stockTop = stockBottom;
+    for (int x = 0; x < workpiece.length; x++)
+    {
+        for (int z = 0; z < workpiece.width; z++)
+        {
+            stockTop = std::max(stockTop, workpiece.getDepth(x, z));
+        }
+    }
+    glm::vec3 sceneLower(0.0f, stockBottom, 0.0f);
+    glm::vec3 sceneUpper((workpiece.length - 1) * workpiece.precision, std::max(stockTop, cutterUpper.y) + 1.0f,
+                         (workpiece.width - 1) * workpiece.precision);
+    ShadowMap shadowMap(sceneLower, sceneUpper, glm::vec3(-0.4f, -1.0f, -0.25f), ASSETS_PATH);
+
+    // Z-map深度更新后刷新顶点与统计
+    auto refreshWorkpiece = [&](const std::vector<int> &tiles) {
+        workpiece.updateCoords(tiles);
+        updateWorkPieceRenderdata(workGL, workpiece, tiles);
+        if (stockStats)
+        {
+            stockStats->update(workpiece, tiles);
+        }
+        if (heightAO)
+        {
+            heightAO->invalidate(tiles);
+        }
+        shadowMap.invalidateTiles(workpiece, tiles, stockTop);
+    };
+
+    // 统计面板；鼠标用于控制视角，面板只显示数据
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 330");
+
     while (!glfwWindowShouldClose(window))
     {
         // 获取间隔时间，以限定视角变动时的画面更新频率
@@ -95,23 +321,103 @@ int main()
         lastFrame = currentFrame;
         processInput(window);
 
-        // 获取当前时间，以限制工件深度更新频率
-        currentUpdateTime = glfwGetTime();
-        // 判断是否要开始铣削
-        if (isNeedUpdate && indices < myPath.size() && currentUpdateTime - lastUpdateTime >= 0.5)
-        {
-            // 工件深度更新
-            updateZmap(workpiece, myCutter, myPath[indices], toolPoisiton);
-            workpiece.depthToCoords();
-            workpiece.generateIndices();
-            workpiece.generateLineIndices();
-            initWorkPieceRenderdata(workGL, workpiece);
+        // 查看模式：按回放时钟应用日志中的帧，开始之前只显示第一帧（初始毛坯）
+        if (isViewer)
+        {
+            if (streamOpen)
+            {
+                streamOpen = deltaClient.take(received);
+                deltaReader.feed(received.data(), received.size());
+                received.clear();
+            }
+            if (isNeedUpdate)
+            {
+                replayClock += deltaTime * playbackSpeed;
+            }
+            double frameTime;
+            bool applied = false;
+            while (deltaReader.peek(frameTime) && frameTime <= replayClock && deltaReader.next(workpiece, deltaFrame))
+            {
+                applied = true;
+            }
+            if (applied)
+            {
+                refreshWorkpiece(workpiece.takeDirtyTiles());
+                placeCutter(deltaFrame.position, deltaFrame.axis);
+            }
+        }
+        // 判断是否要开始铣削，按进给速度推进刀具并铣削到当前插值刀位
+        else if (isNeedUpdate && !player.finished())
+        {
+            player.speedMultiplier = playbackSpeed;
+            simulationTime += deltaTime * playbackSpeed;
+            if (player.advance(stock, myCutter, deltaTime))
+            {
+                if (gpuZMap)
+                {
+                    // 扫掠体立即提交给GPU，深度只按固定间隔读回
+                    gpuZMap->flush();
+                }
+                else if (useTriDexel)
+                {
+                    // 三向dexel毛坯只重新生成被修改分块及其相邻分块的网格，阴影也只重画这些分块
+                    for (int tile : dexel->updateMesh(dexel->takeDirtyTiles(), dexelCoords, dexelIndices))
+                    {
+                        glm::vec3 lower, upper;
+                        dexel->tileBounds(tile, lower, upper);
+                        shadowMap.invalidate(lower, upper);
+                    }
+                    initMeshRenderdata(workGL, dexelCoords, dexelIndices);
+                }
+                else
+                {
+                    // 工件深度更新，只刷新被修改分块的顶点高度
+                    std::vector<int> tiles = workpiece.takeDirtyTiles();
+                    refreshWorkpiece(tiles);
+                    if (deltaWriter)
+                    {
+                        deltaWriter->record(workpiece, tiles, simulationTime, player.getPosition(), player.getAxis());
+                    }
+                }
+            }
+            else if (deltaWriter)
+            {
+                // 刀具没有切到材料时也记录刀位，查看器中的刀具才能连续移动
+                deltaWriter->record(workpiece, {}, simulationTime, player.getPosition(), player.getAxis());
+            }
             // 铣刀位置更新
-            CutterShader.use();
-            cutterModelMatrix = glm::translate(cutterModelMatrix, getTranslateVec(myPath[indices], myCutter.precision));
-            CutterShader.setMat4("Model", cutterModelMatrix);
-            indices++;
-            lastUpdateTime = currentUpdateTime;
+            placeCutter(player.getPosition(), player.getAxis());
+        }
+        if (gpuZMap)
+        {
+            readbackTimer += deltaTime;
+            if (readbackTimer >= 0.25f || isNeedExport)
+            {
+                readbackTimer = 0.0f;
+                gpuZMap->synchronize();
+                refreshWorkpiece(workpiece.takeDirtyTiles());
+            }
+        }
+        // 导出当前工件
+        if (isNeedExport && useTriDexel)
+        {
+            std::cout << "STL export is only available for the Z-map stock" << std::endl;
+            isNeedExport = false;
+        }
+        if (isNeedExport)
+        {
+            long long triangles = exportWorkpieceSTL(workpiece, "workpiece.stl", stockBottom);
+            std::cout << "Exported workpiece.stl: " << triangles << " triangles" << std::endl;
+            isNeedExport = false;
+        }
+        if (heightAO && heightAO->update(workpiece, aoTileBudget) > 0)
+        {
+            heightAO->upload();
+        }
+        if (isShadowOn)
+        {
+            shadowMap.renderStock(workGL[0], useTriDexel ? dexelIndices.size() : workpiece.zmapIndices.size());
+            shadowMap.renderCutter(cutterGL[0], myCutter.ballIndices.size(), cutterModelMatrix, cutterLower, cutterUpper);
         }
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -122,14 +428,41 @@ int main()
         workpieceShader.setMat4("View", myCamera.GetViewMatrix());
         workpieceShader.setMat4("Model", ModelMatrix);
         workpieceShader.setVec3("Colors", glm::vec3(0.4, 0.4, 0.3));
+        workpieceShader.setFloat("Precision", workpiece.precision);
+        workpieceShader.setFloat("GridX", float(workpiece.length));
+        workpieceShader.setFloat("GridZ", float(workpiece.width));
+        workpieceShader.setInt("AOMap", 0);
+        workpieceShader.setBool("UseAO", heightAO != nullptr);
+        if (heightAO)
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, heightAO->texture());
+        }
+        workpieceShader.setMat4("LightSpace", shadowMap.lightSpace());
+        workpieceShader.setInt("StockShadow", 1);
+        workpieceShader.setInt("CutterShadow", 2);
+        workpieceShader.setBool("UseShadow", isShadowOn);
+        shadowMap.bind(1, 2);
         // 绘制workpiece
         glBindVertexArray(workGL[0]);
-        glDrawElements(GL_TRIANGLES, workpiece.zmapIndices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, useTriDexel ? dexelIndices.size() : workpiece.zmapIndices.size(), GL_UNSIGNED_INT, 0);
 
         // 绘制workplace网格
         workpieceShader.setVec3("Colors", glm::vec3(0.0, 0.0, 0.0));
-        glBindVertexArray(workGL[1]);
-        glDrawElements(GL_LINES, workpiece.lineIndices.size(), GL_UNSIGNED_INT, 0);
+        workpieceShader.setBool("UseAO", false);
+        workpieceShader.setBool("UseShadow", false);
+        if (useTriDexel)
+        {
+            // 三向dexel网格没有单独的线条索引，以线框模式再绘制一遍
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            glDrawElements(GL_TRIANGLES, dexelIndices.size(), GL_UNSIGNED_INT, 0);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        }
+        else
+        {
+            glBindVertexArray(workGL[1]);
+            glDrawElements(GL_LINES, workpiece.lineIndices.size(), GL_UNSIGNED_INT, 0);
+        }
 
         CutterShader.use();
         CutterShader.setMat4("Projection", projection);
@@ -142,7 +475,35 @@ int main()
         glBindVertexArray(cutterGL[1]);
         glDrawElements(GL_LINES, myCutter.balllineIndices.size(), GL_UNSIGNED_INT, 0);
 
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+        ImGui::Begin("Stock", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav);
+        ImGui::Text("Engine: %s", isViewer ? "delta log viewer" : useTriDexel ? "tri-dexel" : gpuZMap ? "GPU Z-map" : "Z-map");
+        ImGui::Text("Playback: %.4gx", playbackSpeed);
+        ImGui::Text("Shadows (L): %s, last stock redraw %lld texels", isShadowOn ? "on" : "off", shadowMap.lastStockTexels);
+        if (stockStats)
+        {
+            ImGui::Separator();
+            ImGui::Text("Volume:         %12.3f mm^3", stockStats->volume());
+            ImGui::Text("Removed:        %12.3f mm^3", stockStats->removedVolume());
+            ImGui::Text("Machined area:  %12.3f mm^2", stockStats->machinedArea());
+            ImGui::Text("Projected area: %12.3f mm^2", stockStats->machinedProjectedArea());
+            ImGui::Text("AO tiles queued: %d", heightAO ? heightAO->pendingTiles() : 0);
+        }
+        else
+        {
+            ImGui::Text("Volume statistics are only available for the Z-map stock");
+        }
+        ImGui::End();
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
 }
@@ -0,0 +1,52 @@
+#version 330 core
+flat in vec4 start;
+flat in vec3 end;
+
+// 网格间距（毫米），计算在网格坐标下进行，与CPU上按网格距离采样的刀具轮廓一致，输出时换算为毫米
+uniform float Precision;
+
+out float height;
+
+// 竖直线与球的最低交点，不相交时返回一个很大的值
+float sphereBottom(vec2 p, vec3 center, float radius){
+    vec2 d = p - center.xz;
+    float h = radius * radius - dot(d, d);
+    return h >= 0.0 ? center.y - sqrt(h) : 1e30;
+}
+
+void main(){
+    // 网格点的水平坐标
+    vec2 p = vec2(gl_FragCoord.y - 0.5, gl_FragCoord.x - 0.5);
+    float radius = start.w;
+    vec3 a = start.xyz;
+    vec3 b = end;
+
+    // 胶囊体是两端的球与中间圆柱的并集，最低交点取三者的最小值
+    float lowest = min(sphereBottom(p, a, radius), sphereBottom(p, b, radius));
+    vec3 axis = b - a;
+    float len = length(axis);
+    if (len > 1e-6) {
+        vec3 u = axis / len;
+        float k = 1.0 - u.y * u.y;
+        if (k > 1e-6) {
+            // 相对于轴线上最近点的位置，避免两个大数相减
+            vec3 origin = vec3(p.x, a.y, p.y);
+            vec3 q = a + u * dot(origin - a, u);
+            vec3 o = origin - q;
+            float hb = o.y;
+            float c = dot(o, o) - radius * radius;
+            float h = hb * hb - k * c;
+            if (h >= 0.0) {
+                float t = (-hb - sqrt(h)) / k;
+                float s = dot(q - a, u) + t * u.y;
+                if (s >= 0.0 && s <= len) {
+                    lowest = min(lowest, origin.y + t);
+                }
+            }
+        }
+    }
+    if (lowest > 1e29) {
+        discard;
+    }
+    height = lowest * Precision;
+}
@@ -0,0 +1,29 @@
+#version 330 core
+// 每个实例是一段扫掠：球心从sweepA.xyz移动到sweepB，sweepA.w为半径，均为网格坐标
+layout (location = 0) in vec4 sweepA;
+layout (location = 1) in vec3 sweepB;
+
+// 纹理尺寸：横向为z方向网格数，纵向为x方向网格数
+uniform float GridZ;
+uniform float GridX;
+
+flat out vec4 start;
+flat out vec3 end;
+
+void main(){
+    // 沿扫掠方向的矩形覆盖胶囊体在xz平面上的投影，四周多留一格；斜向的长扫掠只光栅化矩形内的片元
+    vec2 delta = sweepB.xz - sweepA.xz;
+    float len = length(delta);
+    vec2 along = len > 1e-6 ? delta / len : vec2(1.0, 0.0);
+    vec2 side = vec2(-along.y, along.x);
+    float margin = sweepA.w + 1.0;
+    // 三角形带的四个角：第0位选择起点或终点，第1位选择两侧
+    bool atEnd = (gl_VertexID & 1) != 0;
+    float sideSign = (gl_VertexID >> 1) != 0 ? 1.0 : -1.0;
+    vec2 cell = (atEnd ? sweepB.xz + along * margin : sweepA.xz - along * margin) + side * (sideSign * margin);
+    // 网格点位于像素中心
+    vec2 ndc = (vec2(cell.y, cell.x) + 0.5) / vec2(GridZ, GridX) * 2.0 - 1.0;
+    gl_Position = vec4(ndc, 0.0, 1.0);
+    start = sweepA;
+    end = sweepB;
+}
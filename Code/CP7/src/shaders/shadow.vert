@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 vPos;
+
+// 只写入光源视图中的深度
+uniform mat4 LightSpace;
+uniform mat4 Model;
+
+void main(){
+    gl_Position = LightSpace * Model * vec4(vPos,1.0);
+}
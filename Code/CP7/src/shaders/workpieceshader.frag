@@ -1,9 +1,34 @@
 #version 330 core
 
 uniform vec3 Colors;
+// 高度场环境光遮蔽，UseAO为0时（三向dexel网格、网格线）不采样
+uniform sampler2D AOMap;
+uniform bool UseAO;
+// 工件与刀具各自的阴影图，光源投影相同，两者都不遮挡才算受光
+uniform sampler2DShadow StockShadow;
+uniform sampler2DShadow CutterShadow;
+uniform bool UseShadow;
+in vec2 aoCoord;
+in vec4 lightCoord;
 layout(location = 0) out vec4 FragColor;
 
+// 阴影中保留的亮度
+const float ShadowFloor = 0.55;
+
+float lit(){
+    vec3 p = lightCoord.xyz / lightCoord.w * 0.5 + 0.5;
+    // 线性过滤的比较采样已在2x2纹素内插值，再取四个相邻位置使边缘更平滑
+    float sum = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2 offset = vec2(i & 1, i >> 1) - 0.5;
+        vec3 q = vec3(p.xy + offset / vec2(textureSize(StockShadow, 0)), p.z);
+        sum += texture(StockShadow, q) * texture(CutterShadow, q);
+    }
+    return sum * 0.25;
+}
 
 void main(){
-    FragColor = vec4(Colors,1.0);
-}
\ No newline at end of file
+    float visibility = UseAO ? texture(AOMap, aoCoord).r : 1.0;
+    float light = UseShadow ? mix(ShadowFloor, 1.0, lit()) : 1.0;
+    FragColor = vec4(Colors * visibility * light,1.0);
+}
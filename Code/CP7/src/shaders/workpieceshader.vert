@@ -4,8 +4,19 @@ layout (location = 0) in vec3 vPos;
 uniform mat4 Model;
 uniform mat4 View;
 uniform mat4 Projection;
+// Z-map网格间距与网格数，用于求遮蔽纹理坐标（纹理横向为z、纵向为x，网格点位于像素中心）
+uniform float Precision;
+uniform float GridX;
+uniform float GridZ;
+// 世界坐标到光源裁剪空间
+uniform mat4 LightSpace;
 
-void main(){
-    gl_Position = Projection * View * Model * vec4(vPos,1.0);
+out vec2 aoCoord;
+out vec4 lightCoord;
 
-}
\ No newline at end of file
+void main(){
+    vec4 world = Model * vec4(vPos,1.0);
+    gl_Position = Projection * View * world;
+    aoCoord = (vPos.zx / Precision + 0.5) / vec2(GridZ, GridX);
+    lightCoord = LightSpace * world;
+}
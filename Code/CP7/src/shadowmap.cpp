@@ -0,0 +1,204 @@
+#include "shadowmap.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// 创建只有深度附件的帧缓冲，深度纹理按比较模式采样
+static void createDepthTarget(int size, GLuint &texture, GLuint &framebuffer)
+{
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    // 线性过滤时比较结果由硬件插值（2x2 PCF）
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    // 初始为最远深度，即没有遮挡
+    glClearDepth(1.0);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("depth framebuffer is not supported");
+    }
+}
+
+ShadowMap::ShadowMap(glm::vec3 lower, glm::vec3 upper, glm::vec3 lightDir, const std::string &shaderDir, int size)
+    : resolution(size), shader((shaderDir + "/shadow.vert").c_str(), (shaderDir + "/shadow.frag").c_str())
+{
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    resolution = std::clamp(resolution, 1, int(maxSize));
+
+    // 光源视图沿光线方向看向范围中心，正交投影恰好包住整个范围
+    glm::vec3 dir = glm::normalize(lightDir);
+    glm::vec3 center = (lower + upper) * 0.5f;
+    glm::vec3 up = std::fabs(dir.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 view = glm::lookAt(center - dir * glm::length(upper - lower), center, up);
+    glm::vec3 viewLower(1e30f), viewUpper(-1e30f);
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner((i & 1) ? upper.x : lower.x, (i & 2) ? upper.y : lower.y, (i & 4) ? upper.z : lower.z);
+        glm::vec3 p = glm::vec3(view * glm::vec4(corner, 1.0f));
+        viewLower = glm::min(viewLower, p);
+        viewUpper = glm::max(viewUpper, p);
+    }
+    // 视图空间朝-z方向看
+    glm::mat4 proj = glm::ortho(viewLower.x, viewUpper.x, viewLower.y, viewUpper.y, -viewUpper.z - 1.0f, -viewLower.z + 1.0f);
+    lightMatrix = proj * view;
+
+    createDepthTarget(resolution, stockTexture, stockFramebuffer);
+    createDepthTarget(resolution, cutterTexture, cutterFramebuffer);
+    invalidateAll();
+}
+
+ShadowMap::~ShadowMap()
+{
+    glDeleteFramebuffers(1, &stockFramebuffer);
+    glDeleteFramebuffers(1, &cutterFramebuffer);
+    glDeleteTextures(1, &stockTexture);
+    glDeleteTextures(1, &cutterTexture);
+}
+
+ShadowMap::Rect ShadowMap::project(const glm::mat4 &toLight, glm::vec3 lower, glm::vec3 upper, int margin) const
+{
+    glm::vec2 low(1e30f), high(-1e30f);
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner((i & 1) ? upper.x : lower.x, (i & 2) ? upper.y : lower.y, (i & 4) ? upper.z : lower.z);
+        glm::vec4 clip = toLight * glm::vec4(corner, 1.0f);
+        glm::vec2 texel = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * float(resolution);
+        low = glm::min(low, texel);
+        high = glm::max(high, texel);
+    }
+    Rect rect;
+    rect.x0 = std::clamp(int(std::floor(low.x)) - margin, 0, resolution);
+    rect.y0 = std::clamp(int(std::floor(low.y)) - margin, 0, resolution);
+    rect.x1 = std::clamp(int(std::ceil(high.x)) + margin, 0, resolution);
+    rect.y1 = std::clamp(int(std::ceil(high.y)) + margin, 0, resolution);
+    return rect;
+}
+
+ShadowMap::Rect ShadowMap::unite(const Rect &a, const Rect &b)
+{
+    if (a.empty())
+        return b;
+    if (b.empty())
+        return a;
+    return {std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+}
+
+void ShadowMap::invalidate(glm::vec3 lower, glm::vec3 upper)
+{
+    // 多留两个纹素，覆盖线性过滤与深度偏移的影响
+    stockDirty = unite(stockDirty, project(lightMatrix, lower, upper, 2));
+}
+
+void ShadowMap::invalidateTiles(const WorkPiece &workpiece, const std::vector<int> &tiles, float top)
+{
+    for (int tile : tiles)
+    {
+        int x0, x1, z0, z1;
+        workpiece.tileBounds(tile, x0, x1, z0, z1);
+        // 分块边界外一格的网格单元也引用了分块内的顶点
+        x0 = std::max(x0 - 1, 0);
+        z0 = std::max(z0 - 1, 0);
+        x1 = std::min(x1, workpiece.length - 1);
+        z1 = std::min(z1, workpiece.width - 1);
+        float bottom = top;
+        for (int x = x0; x <= x1; x++)
+        {
+            for (int z = z0; z <= z1; z++)
+            {
+                bottom = std::min(bottom, workpiece.getDepth(x, z));
+            }
+        }
+        float p = workpiece.precision;
+        invalidate(glm::vec3(x0 * p, bottom, z0 * p), glm::vec3(x1 * p, top, z1 * p));
+    }
+}
+
+void ShadowMap::invalidateAll()
+{
+    stockDirty = {0, 0, resolution, resolution};
+}
+
+void ShadowMap::draw(GLuint framebuffer, const Rect &rect, GLuint vao, GLsizei indexCount, const glm::mat4 &model)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean cull = glIsEnabled(GL_CULL_FACE);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, resolution, resolution);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(rect.x0, rect.y0, rect.x1 - rect.x0, rect.y1 - rect.y0);
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    // Z-map只有顶面，两面都要写入；光源范围外的刀杆按近、远平面截断而不是被裁掉
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    shader.use();
+    shader.setMat4("LightSpace", lightMatrix);
+    shader.setMat4("Model", model);
+    glBindVertexArray(vao);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    glDisable(GL_SCISSOR_TEST);
+    if (cull)
+        glEnable(GL_CULL_FACE);
+    if (!depthTest)
+        glDisable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+bool ShadowMap::renderStock(GLuint vao, GLsizei indexCount)
+{
+    if (stockDirty.empty())
+    {
+        return false;
+    }
+    draw(stockFramebuffer, stockDirty, vao, indexCount, glm::mat4(1.0f));
+    lastStockTexels = (long long)(stockDirty.x1 - stockDirty.x0) * (stockDirty.y1 - stockDirty.y0);
+    stockDirty = {0, 0, 0, 0};
+    return true;
+}
+
+void ShadowMap::renderCutter(GLuint vao, GLsizei indexCount, const glm::mat4 &model, glm::vec3 modelLower, glm::vec3 modelUpper)
+{
+    // 清除上一帧刀具的阴影，再画当前帧的
+    Rect current = project(lightMatrix * model, modelLower, modelUpper, 2);
+    Rect rect = unite(current, cutterLast);
+    cutterLast = current;
+    if (!rect.empty())
+    {
+        draw(cutterFramebuffer, rect, vao, indexCount, model);
+    }
+}
+
+void ShadowMap::bind(int stockUnit, int cutterUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + stockUnit);
+    glBindTexture(GL_TEXTURE_2D, stockTexture);
+    glActiveTexture(GL_TEXTURE0 + cutterUnit);
+    glBindTexture(GL_TEXTURE_2D, cutterTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "workpiece.hpp"
+
+// 平行光阴影：工件与刀具各用一张深度纹理，光源投影相同
+// 工件的阴影图缓存下来，毛坯被修改后只在光源视图中覆盖被修改分块的矩形内（裁剪测试）重新绘制；
+// 刀具的阴影图每帧重画，但只清除、绘制刀具上一帧与当前帧所覆盖的矩形，
+// 因此打开阴影后每帧增加的开销只与刀具大小有关
+class ShadowMap
+{
+public:
+    // lower、upper为需要投射、接收阴影的范围（毫米，包含刀具可能到达的高度），lightDir为光线传播方向；
+    // 需要OpenGL上下文，shaderDir为shadow.vert/frag所在目录
+    ShadowMap(glm::vec3 lower, glm::vec3 upper, glm::vec3 lightDir, const std::string &shaderDir, int size = 2048);
+    ~ShadowMap();
+
+    ShadowMap(const ShadowMap &) = delete;
+    ShadowMap &operator=(const ShadowMap &) = delete;
+
+    // 世界坐标到光源裁剪空间的变换
+    const glm::mat4 &lightSpace() const { return lightMatrix; }
+
+    // 标记一个世界坐标范围内的工件阴影需要重画
+    void invalidate(glm::vec3 lower, glm::vec3 upper);
+
+    // 标记Z-map被修改分块的阴影需要重画；高度范围从分块当前最低点到top（切削前的表面不高于top）
+    void invalidateTiles(const WorkPiece &workpiece, const std::vector<int> &tiles, float top);
+
+    // 整张工件阴影图需要重画
+    void invalidateAll();
+
+    // 若有需要重画的区域，用vao中的indexCount个索引（GL_TRIANGLES）重画工件的阴影图，返回是否重画
+    bool renderStock(GLuint vao, GLsizei indexCount);
+
+    // 重画刀具的阴影图；modelLower、modelUpper为刀具模型坐标下的包围盒
+    void renderCutter(GLuint vao, GLsizei indexCount, const glm::mat4 &model, glm::vec3 modelLower, glm::vec3 modelUpper);
+
+    // 把两张阴影图绑定到纹理单元stockUnit、cutterUnit
+    void bind(int stockUnit, int cutterUnit) const;
+
+    int size() const { return resolution; }
+
+    // 上一次重画工件阴影图时更新的纹素数
+    long long lastStockTexels = 0;
+
+private:
+    // 光源视图中的矩形（纹素，左下角与右上角，不含右上角）
+    struct Rect
+    {
+        int x0, y0, x1, y1;
+        bool empty() const { return x0 >= x1 || y0 >= y1; }
+    };
+
+    int resolution;
+    Shader shader;
+    glm::mat4 lightMatrix;
+    GLuint stockTexture = 0;
+    GLuint cutterTexture = 0;
+    GLuint stockFramebuffer = 0;
+    GLuint cutterFramebuffer = 0;
+    Rect stockDirty = {0, 0, 0, 0};
+    Rect cutterLast = {0, 0, 0, 0};
+
+    // 把世界坐标下的包围盒投影到光源视图，向外扩展margin个纹素
+    Rect project(const glm::mat4 &toLight, glm::vec3 lower, glm::vec3 upper, int margin) const;
+    static Rect unite(const Rect &a, const Rect &b);
+    // 在framebuffer的rect范围内清除深度并绘制
+    void draw(GLuint framebuffer, const Rect &rect, GLuint vao, GLsizei indexCount, const glm::mat4 &model);
+};
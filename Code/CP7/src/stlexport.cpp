@@ -0,0 +1,199 @@
+#include "stlexport.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+// 二进制STL的流式写出器：三角形先写入缓冲区，每处理完一个分块写入文件，最后回填三角形数
+class StlWriter
+{
+public:
+    explicit StlWriter(const std::string &path) : file(path, std::ios::binary)
+    {
+        char header[80] = {};
+        std::strncpy(header, "ZMapRenderer workpiece", sizeof(header) - 1);
+        uint32_t count = 0;
+        file.write(header, sizeof(header));
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    }
+
+    bool good() const
+    {
+        return file.good();
+    }
+
+    // 添加三角形，法线由顶点顺序（逆时针）确定，退化三角形被忽略
+    void addTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+    {
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float area = glm::length(normal);
+        if (area <= 0.0f)
+        {
+            return;
+        }
+        normal /= area;
+        float record[12] = {normal.x, normal.y, normal.z, a.x, a.y, a.z, b.x, b.y, b.z, c.x, c.y, c.z};
+        size_t offset = buffer.size();
+        buffer.resize(offset + 50);
+        std::memcpy(&buffer[offset], record, sizeof(record));
+        std::memset(&buffer[offset + 48], 0, 2);
+        triangles++;
+    }
+
+    void flush()
+    {
+        file.write(buffer.data(), std::streamsize(buffer.size()));
+        buffer.clear();
+    }
+
+    long long finish()
+    {
+        flush();
+        uint32_t count = uint32_t(triangles);
+        file.seekp(80);
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        file.close();
+        return file.fail() ? -1 : triangles;
+    }
+
+private:
+    std::ofstream file;
+    std::vector<char> buffer;
+    long long triangles = 0;
+};
+
+long long exportWorkpieceSTL(const WorkPiece &workpiece, const std::string &path, float bottomDepth, bool decimate)
+{
+    if (workpiece.length < 2 || workpiece.width < 2)
+    {
+        return -1;
+    }
+    StlWriter writer(path);
+    if (!writer.good())
+    {
+        std::cerr << "Failed to open STL file: " << path << std::endl;
+        return -1;
+    }
+
+    const int lastX = workpiece.length - 1;
+    const int lastZ = workpiece.width - 1;
+    const float p = workpiece.precision;
+    auto top = [&](int x, int z) {
+        return glm::vec3(float(x) * p, std::max(workpiece.getDepth(x, z), bottomDepth), float(z) * p);
+    };
+    auto bottom = [&](int x, int z) {
+        return glm::vec3(float(x) * p, bottomDepth, float(z) * p);
+    };
+
+    // 分块边界上的网格点，按俯视逆时针（+z、+x、-z、-x）排列；
+    // 分块之间的内部边只取两个角点，工件外边界上的边取全部网格点
+    std::vector<glm::ivec2> ring;
+    auto buildRing = [&](int x0, int x1, int z0, int z1, bool allPoints) {
+        ring.clear();
+        auto edge = [&](glm::ivec2 from, glm::ivec2 to, bool dense) {
+            glm::ivec2 step = glm::sign(to - from);
+            int n = std::max(std::abs(to.x - from.x), std::abs(to.y - from.y));
+            for (int k = 0; k < n; k += (dense ? 1 : n))
+            {
+                ring.push_back(from + step * k);
+            }
+        };
+        edge({x0, z0}, {x0, z1}, allPoints || x0 == 0);
+        edge({x0, z1}, {x1, z1}, allPoints || z1 == lastZ);
+        edge({x1, z1}, {x1, z0}, allPoints || x1 == lastX);
+        edge({x1, z0}, {x0, z0}, allPoints || z0 == 0);
+    };
+
+    for (int tile = 0; tile < workpiece.tilesX * workpiece.tilesZ; tile++)
+    {
+        // 分块内的网格单元范围为[x0, x1) x [z0, z1)，对应网格点[x0, x1] x [z0, z1]
+        int x0, x1, z0, z1;
+        workpiece.tileBounds(tile, x0, x1, z0, z1);
+        x1 = std::min(x1, lastX);
+        z1 = std::min(z1, lastZ);
+        if (x0 >= x1 || z0 >= z1)
+        {
+            continue;
+        }
+
+        // 顶面
+        bool flat = decimate;
+        float h = top(x0, z0).y;
+        for (int x = x0; x <= x1 && flat; x++)
+        {
+            for (int z = z0; z <= z1 && flat; z++)
+            {
+                flat = top(x, z).y == h;
+            }
+        }
+        if (flat)
+        {
+            buildRing(x0, x1, z0, z1, true);
+            glm::vec3 center(float(x0 + x1) * 0.5f * p, h, float(z0 + z1) * 0.5f * p);
+            for (size_t k = 0; k < ring.size(); k++)
+            {
+                glm::ivec2 a = ring[k], b = ring[(k + 1) % ring.size()];
+                writer.addTriangle(center, top(a.x, a.y), top(b.x, b.y));
+            }
+        }
+        else
+        {
+            for (int x = x0; x < x1; x++)
+            {
+                for (int z = z0; z < z1; z++)
+                {
+                    glm::vec3 v0 = top(x, z), v1 = top(x, z + 1), v2 = top(x + 1, z + 1), v3 = top(x + 1, z);
+                    writer.addTriangle(v0, v1, v2);
+                    writer.addTriangle(v0, v2, v3);
+                }
+            }
+        }
+
+        // 底面：以分块中心为顶点的扇形，朝下
+        buildRing(x0, x1, z0, z1, false);
+        glm::vec3 bottomCenter(float(x0 + x1) * 0.5f * p, bottomDepth, float(z0 + z1) * 0.5f * p);
+        for (size_t k = 0; k < ring.size(); k++)
+        {
+            glm::ivec2 a = ring[k], b = ring[(k + 1) % ring.size()];
+            writer.addTriangle(bottomCenter, bottom(b.x, b.y), bottom(a.x, a.y));
+        }
+
+        // 位于工件外边界的分块输出对应的侧壁
+        if (x0 == 0)
+        {
+            for (int z = z0; z < z1; z++)
+            {
+                writer.addTriangle(top(0, z), bottom(0, z), bottom(0, z + 1));
+                writer.addTriangle(top(0, z), bottom(0, z + 1), top(0, z + 1));
+            }
+        }
+        if (x1 == lastX)
+        {
+            for (int z = z0; z < z1; z++)
+            {
+                writer.addTriangle(top(lastX, z), top(lastX, z + 1), bottom(lastX, z + 1));
+                writer.addTriangle(top(lastX, z), bottom(lastX, z + 1), bottom(lastX, z));
+            }
+        }
+        if (z0 == 0)
+        {
+            for (int x = x0; x < x1; x++)
+            {
+                writer.addTriangle(top(x, 0), top(x + 1, 0), bottom(x + 1, 0));
+                writer.addTriangle(top(x, 0), bottom(x + 1, 0), bottom(x, 0));
+            }
+        }
+        if (z1 == lastZ)
+        {
+            for (int x = x0; x < x1; x++)
+            {
+                writer.addTriangle(top(x, lastZ), bottom(x, lastZ), bottom(x + 1, lastZ));
+                writer.addTriangle(top(x, lastZ), bottom(x + 1, lastZ), top(x + 1, lastZ));
+            }
+        }
+        writer.flush();
+    }
+    return writer.finish();
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+#include "workpiece.hpp"
+
+// 把工件导出为封闭的二进制STL实体（顶面、四周侧壁与底面），坐标与渲染一致（y为高度）
+// 按分块逐块生成三角形并写出，不会在内存中构建整个三角形列表
+// bottomDepth为实体底面高度，低于它的深度按底面处理；
+// decimate为true时，深度完全相同的平坦分块只输出以分块中心为顶点的扇形，边界点保持不变以保证封闭
+// 返回写出的三角形数，失败返回-1
+long long exportWorkpieceSTL(const WorkPiece &workpiece, const std::string &path, float bottomDepth, bool decimate = true);
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "cutter.hpp"
+
+// 毛坯模型的仿真接口，Z-map（WorkPiece）与三向dexel（TriDexel）都实现该接口
+class Stock
+{
+public:
+    virtual ~Stock() = default;
+
+    // 在刀位toolPosition（网格坐标，与Cutter的采样网格原点对应）处、沿刀轴toolAxis切除材料，返回是否有材料被切除
+    virtual bool stampCutter(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis) = 0;
+
+    // 竖直刀轴
+    bool stampCutter(const Cutter &cutter, glm::vec3 toolPosition)
+    {
+        return stampCutter(cutter, toolPosition, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    // 依次在多个刀位处切除材料，axes为各刀位的刀轴，为空时刀轴竖直；实现可以对整批刀位做并行处理
+    virtual bool stampPath(const Cutter &cutter, const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &axes)
+    {
+        bool changed = false;
+        for (size_t i = 0; i < positions.size(); i++)
+        {
+            changed |= stampCutter(cutter, positions[i], axes.empty() ? glm::vec3(0.0f, 1.0f, 0.0f) : axes[i]);
+        }
+        return changed;
+    }
+
+    // 取出自上次调用以来被修改过的分块（xz平面上WorkPiece::TILE_SIZE见方）编号，并清空标记
+    virtual std::vector<int> takeDirtyTiles() = 0;
+
+    // 生成用于渲染的三角网格：coords为xyz顶点坐标，indices为三角形顶点索引
+    virtual void buildMesh(std::vector<float> &coords, std::vector<int> &indices) = 0;
+};
@@ -0,0 +1,113 @@
+#include "stockstats.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+
+StockStats::StockStats(const WorkPiece &workpiece, float bottom)
+    : length(workpiece.length), width(workpiece.width), tilesZ(workpiece.tilesZ), precision(workpiece.precision), bottom(bottom),
+      tolerance(workpiece.heightUnit * 0.5f), cellArea(double(workpiece.precision) * workpiece.precision)
+{
+    initial.resize(size_t(length) * width);
+    parallelFor(length, [&](int x) {
+        for (int z = 0; z < width; z++)
+        {
+            initial[size_t(x) * width + z] = workpiece.getDepth(x, z);
+        }
+    });
+    size_t tiles = size_t(workpiece.tilesX) * tilesZ;
+    tileVolume.assign(tiles, 0.0);
+    tileArea.assign(tiles, 0.0);
+    tileMachined.assign(tiles, 0);
+    pending.assign(tiles, 0);
+    std::vector<int> all(tiles);
+    for (size_t i = 0; i < tiles; i++)
+    {
+        all[i] = int(i);
+    }
+    update(workpiece, all);
+    initialVolume = totalVolume;
+}
+
+void StockStats::measureTile(const WorkPiece &workpiece, int tile)
+{
+    int x0, x1, z0, z1;
+    workpiece.tileBounds(tile, x0, x1, z0, z1);
+    double volume = 0.0;
+    double area = 0.0;
+    int machined = 0;
+    for (int x = x0; x < x1; x++)
+    {
+        for (int z = z0; z < z1; z++)
+        {
+            float d00 = workpiece.getDepth(x, z);
+            volume += std::max(d00 - bottom, 0.0f);
+            // 以(x, z)为左下角的四边形，最后一行、一列没有四边形
+            if (x + 1 >= length || z + 1 >= width)
+            {
+                continue;
+            }
+            float d10 = workpiece.getDepth(x + 1, z);
+            float d01 = workpiece.getDepth(x, z + 1);
+            float d11 = workpiece.getDepth(x + 1, z + 1);
+            const float *i0 = &initial[size_t(x) * width + z];
+            const float *i1 = i0 + width;
+            if (d00 < i0[0] - tolerance || d01 < i0[1] - tolerance || d10 < i1[0] - tolerance || d11 < i1[1] - tolerance)
+            {
+                // 沿(x, z)-(x+1, z+1)对角线分成两个三角形
+                glm::vec3 p00(0.0f, d00, 0.0f);
+                glm::vec3 p10(precision, d10, 0.0f);
+                glm::vec3 p01(0.0f, d01, precision);
+                glm::vec3 p11(precision, d11, precision);
+                area += 0.5 * (glm::length(glm::cross(p10 - p00, p11 - p00)) + glm::length(glm::cross(p11 - p00, p01 - p00)));
+                machined++;
+            }
+        }
+    }
+    tileVolume[tile] = volume * cellArea;
+    tileArea[tile] = area;
+    tileMachined[tile] = machined;
+}
+
+void StockStats::update(const WorkPiece &workpiece, const std::vector<int> &tiles)
+{
+    // 分块边缘的四边形用到相邻分块的网格点，左、下与左下方的分块也要重新计算
+    std::vector<int> work;
+    for (int tile : tiles)
+    {
+        int tx = tile / tilesZ;
+        int tz = tile % tilesZ;
+        for (int dx = -1; dx <= 0; dx++)
+        {
+            for (int dz = -1; dz <= 0; dz++)
+            {
+                if (tx + dx < 0 || tz + dz < 0)
+                {
+                    continue;
+                }
+                int neighbour = (tx + dx) * tilesZ + tz + dz;
+                if (!pending[neighbour])
+                {
+                    pending[neighbour] = 1;
+                    work.push_back(neighbour);
+                }
+            }
+        }
+    }
+    std::sort(work.begin(), work.end());
+
+    // 先减去旧的部分和，各分块并行重新统计后再加上新的部分和，按分块顺序累加，结果与线程数无关
+    for (int tile : work)
+    {
+        totalVolume -= tileVolume[tile];
+        totalArea -= tileArea[tile];
+        totalMachined -= tileMachined[tile];
+        pending[tile] = 0;
+    }
+    parallelFor(int(work.size()), [&](int i) { measureTile(workpiece, work[i]); }, 4);
+    for (int tile : work)
+    {
+        totalVolume += tileVolume[tile];
+        totalArea += tileArea[tile];
+        totalMachined += tileMachined[tile];
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "workpiece.hpp"
+
+// 毛坯剩余体积与已加工表面积的增量统计
+// 每个分块保存自己的部分和，update只重新计算被修改的分块（并行），总量按分块的新旧差值调整，不再扫描整个深度数组；
+// 判断是否已加工需要保存一份初始深度，内存与Float格式的深度数据相同
+class StockStats
+{
+public:
+    // 以workpiece当前的深度为初始毛坯，bottom为毛坯底面高度（毫米）
+    StockStats(const WorkPiece &workpiece, float bottom);
+
+    // 重新统计给定分块，通常为takeDirtyTiles的结果
+    void update(const WorkPiece &workpiece, const std::vector<int> &tiles);
+
+    // 剩余体积与已切除体积（立方毫米），每个网格点代表precision见方的柱体
+    double volume() const { return totalVolume; }
+    double removedVolume() const { return initialVolume - totalVolume; }
+
+    // 已加工表面的面积（平方毫米）：至少有一个顶点低于初始深度的网格四边形，按三维面积计算
+    double machinedArea() const { return totalArea; }
+
+    // 已加工区域在xz平面上的投影面积（平方毫米）
+    double machinedProjectedArea() const { return double(totalMachined) * cellArea; }
+
+private:
+    int length;
+    int width;
+    int tilesZ;
+    float precision;
+    float bottom;
+    // 低于初始深度超过该值才算已加工，忽略定点量化误差
+    float tolerance;
+    double cellArea;
+    std::vector<float> initial;
+    std::vector<double> tileVolume;
+    std::vector<double> tileArea;
+    std::vector<int> tileMachined;
+    std::vector<uint8_t> pending;
+    double initialVolume = 0.0;
+    double totalVolume = 0.0;
+    double totalArea = 0.0;
+    long long totalMachined = 0;
+
+    void measureTile(const WorkPiece &workpiece, int tile);
+};
@@ -1,4 +1,6 @@
 #include "tool.hpp"
+#include <algorithm>
+#include <iostream>
 
 // 初始化外部变量（确保它们在一个 .cpp 文件中定义）
 float deltaTime = 0.0f;
@@ -7,10 +9,11 @@ bool firstMouse = true;
 float lastX = width / 2;
 float lastY = height / 2;
 bool isNeedUpdate = false;
+float playbackSpeed = 1.0f;
+bool isNeedExport = false;
+bool isShadowOn = true;
 Camera myCamera(glm::vec3(1.0, 2.5, 1.0), glm::vec3(0.0, 1.0, 0.0), 60.0f, 0.0f);
 glm::mat4 projection = glm::perspective(glm::radians(myCamera.GetZoom()), (float)width / (float)height, 0.1f, 100.0f);
-double currentUpdateTime = 0.0;
-double lastUpdateTime = 0.0;
 glm::mat4 cutterModelMatrix = glm::mat4(1.0);
 
 
@@ -54,10 +57,12 @@ std::vector<Toolpath> myPath = {
     {glm::vec3(0.0f, 0.0f, 1.0f), 5},
     {glm::vec3(0.0f, 0.0f, 1.0f), 5},
     {glm::vec3(0.0f, 0.0f, 1.0f), 5},
+    // 五轴段：刀轴逐渐向+x倾斜后沿-x方向走刀，最后摆回竖直
+    {glm::vec3(-1.0f, 0.0f, 0.0f), 20, 0.0f, glm::vec3(0.5f, 1.0f, 0.0f)},
+    {glm::vec3(-1.0f, 0.0f, 0.0f), 40, 0.0f, glm::vec3(0.5f, 1.0f, 0.0f)},
+    {glm::vec3(-1.0f, 0.0f, 0.0f), 20, 0.0f, glm::vec3(0.0f, 1.0f, 0.0f)},
 };
 
-int indices = 0;
-
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
     glViewport(0, 0, width, height);
@@ -87,6 +92,45 @@ void scroll_callback(GLFWwindow *window, double xOffset, double yOffset)
     myCamera.ProcessMouseScroll(static_cast<float>(yOffset));
 }
 
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS)
+    {
+        return;
+    }
+    // 回放倍速：+ 加倍，- 减半，0 恢复原速
+    if (key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD)
+    {
+        playbackSpeed = std::min(playbackSpeed * 2.0f, 1024.0f);
+    }
+    else if (key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT)
+    {
+        playbackSpeed = std::max(playbackSpeed * 0.5f, 1.0f / 16.0f);
+    }
+    else if (key == GLFW_KEY_0)
+    {
+        playbackSpeed = 1.0f;
+    }
+    else if (key == GLFW_KEY_E)
+    {
+        // E 导出当前工件为STL
+        isNeedExport = true;
+        return;
+    }
+    else if (key == GLFW_KEY_L)
+    {
+        // L 打开或关闭阴影
+        isShadowOn = !isShadowOn;
+        std::cout << "Shadows: " << (isShadowOn ? "on" : "off") << std::endl;
+        return;
+    }
+    else
+    {
+        return;
+    }
+    std::cout << "Playback speed: " << playbackSpeed << "x" << std::endl;
+}
+
 void processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
@@ -131,21 +175,65 @@ void initWorkPieceRenderdata(std::vector<GLuint> &workGL, WorkPiece &workpiece)
 {
     glBindVertexArray(workGL[0]);
     glBindBuffer(GL_ARRAY_BUFFER, workGL[2]);
-    glBufferData(GL_ARRAY_BUFFER, workpiece.zmapCoords.size() * sizeof(float), workpiece.zmapCoords.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, workpiece.zmapCoords.size() * sizeof(float), workpiece.zmapCoords.data(), GL_DYNAMIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, workGL[3]);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, workpiece.zmapIndices.size() * sizeof(int), workpiece.zmapIndices.data(), GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
 
+    // 网格线与三角形共用同一个顶点缓冲，顶点只需上传一次
     glBindVertexArray(workGL[1]);
-    glBindBuffer(GL_ARRAY_BUFFER, workGL[4]);
-    glBufferData(GL_ARRAY_BUFFER, workpiece.zmapCoords.size() * sizeof(float), workpiece.zmapCoords.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, workGL[2]);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, workGL[5]);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, workpiece.lineIndices.size() * sizeof(int), workpiece.lineIndices.data(), GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
 }
 
+void updateWorkPieceRenderdata(std::vector<GLuint> &workGL, const WorkPiece &workpiece, const std::vector<int> &tiles)
+{
+    if (tiles.empty())
+    {
+        return;
+    }
+    // 与updateCoords相同的单元范围；顶点按x行连续存放，每行只上传被修改单元覆盖的一段
+    std::vector<int> rowBegin(workpiece.length, workpiece.width);
+    std::vector<int> rowEnd(workpiece.length, 0);
+    for (int tile : tiles)
+    {
+        int x0, x1, z0, z1;
+        workpiece.tileBounds(tile, x0, x1, z0, z1);
+        for (int x = std::max(x0 - 1, 0); x < std::min(x1, workpiece.length - 1); x++)
+        {
+            rowBegin[x] = std::min(rowBegin[x], std::max(z0 - 1, 0));
+            rowEnd[x] = std::max(rowEnd[x], std::min(z1, workpiece.width - 1));
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, workGL[2]);
+    for (int x = 0; x < workpiece.length - 1; x++)
+    {
+        if (rowBegin[x] >= rowEnd[x])
+        {
+            continue;
+        }
+        // 每个网格单元4个顶点共12个float
+        size_t first = (size_t(x) * (workpiece.width - 1) + rowBegin[x]) * 12;
+        size_t count = size_t(rowEnd[x] - rowBegin[x]) * 12;
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(float), count * sizeof(float), workpiece.zmapCoords.data() + first);
+    }
+}
+
+void initMeshRenderdata(std::vector<GLuint> &workGL, const std::vector<float> &coords, const std::vector<int> &indices)
+{
+    glBindVertexArray(workGL[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, workGL[2]);
+    glBufferData(GL_ARRAY_BUFFER, coords.size() * sizeof(float), coords.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, workGL[3]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(int), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(0);
+}
+
 void initCutterRenderdata(std::vector<GLuint> &cutterGL, Cutter &myCutter)
 {
     glBindVertexArray(cutterGL[0]);
@@ -164,29 +252,3 @@ void initCutterRenderdata(std::vector<GLuint> &cutterGL, Cutter &myCutter)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
 }
-
-void updateZmap(WorkPiece &workpiece, Cutter &cutter, Toolpath myPath, glm::vec3 &toolPosition)
-{
-    int wpwidth = workpiece.width;
-    int wplength = workpiece.length;
-    int cwidth = cutter.width;
-    int clength = cutter.length;
-    for (int m = 0; m < myPath.length; m++)
-    {
-        for (int i = 0; i < cwidth; i++)
-        {
-            for (int j = 0; j < clength; j++)
-            {
-                if ((i + toolPosition.x + myPath.direction.x * m + 1 > wpwidth) || (j + toolPosition.z + myPath.direction.z * m + 1 > wplength) || (j + toolPosition.z + myPath.direction.z * m + 1 <= 0) || (i + toolPosition.x + myPath.direction.x * m + 1 <= 0))
-                {
-                    continue;
-                }
-                if (workpiece.depthData[(i + toolPosition.x + myPath.direction.x * m) * wplength + toolPosition.z + j + myPath.direction.z * m] > (cutter.depthData[i * clength + j] + (toolPosition.y + myPath.direction.y*m) * cutter.precision))
-                {
-                    workpiece.depthData[(i + toolPosition.x + myPath.direction.x * m) * wplength + toolPosition.z + j + myPath.direction.z * m] = cutter.depthData[i * clength + j] + (toolPosition.y + myPath.direction.y*m) * cutter.precision;
-                }
-            }
-        }
-    }
-    toolPosition = toolPosition + glm::vec3(myPath.direction.x * myPath.length, myPath.direction.y * myPath.length, myPath.direction.z * myPath.length);
-}
\ No newline at end of file
@@ -6,12 +6,7 @@
 #include "camera.hpp"
 #include "workpiece.hpp"
 #include "cutter.hpp"
-
-//方向、移动距离
-struct Toolpath{
-    glm::vec3 direction;
-    int length;
-};
+#include "player.hpp"
 
 const float width = 1200.0;
 const float height = 1200.0;
@@ -22,12 +17,12 @@ extern bool firstMouse;
 extern float lastX;
 extern float lastY;
 extern bool isNeedUpdate;
-extern double currentUpdateTime;
-extern double lastUpdateTime;
+extern float playbackSpeed;
+extern bool isNeedExport;
+extern bool isShadowOn;
 extern Camera myCamera;
 extern glm::mat4 projection;
 extern std::vector<Toolpath> myPath;
-extern int indices;
 
 extern glm::mat4 cutterModelMatrix;
 
@@ -35,11 +30,15 @@ extern glm::mat4 cutterModelMatrix;
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xPos, double yPos);
 void scroll_callback(GLFWwindow *window, double xOffset, double yOffset);
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
 void initWorkpieceData(WorkPiece &data);
 void initWorkPieceRenderdata(std::vector<GLuint>& workGL,WorkPiece& workpiece);
+// 只上传被修改分块的顶点，顶点缓冲须已由initWorkPieceRenderdata分配
+void updateWorkPieceRenderdata(std::vector<GLuint>& workGL,const WorkPiece& workpiece,const std::vector<int>& tiles);
+// 用任意三角网格（如三向dexel毛坯的网格）更新工件的绘制数据，不包含网格线
+void initMeshRenderdata(std::vector<GLuint>& workGL,const std::vector<float>& coords,const std::vector<int>& indices);
 void initCutterRenderdata(std::vector<GLuint>& cutterGL,Cutter& myCutter);
-void updateZmap(WorkPiece &workpiece, Cutter &cutter,Toolpath myPath,glm::vec3 &toolPosition);
 inline glm::vec3 getTranslateVec(Toolpath path,float precision){
     return glm::vec3(path.direction.x * path.length * precision,path.direction.y * path.length * precision,path.direction.z * path.length * precision);
 }
\ No newline at end of file
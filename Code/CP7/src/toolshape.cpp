@@ -0,0 +1,143 @@
+#include "toolshape.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // 牛顿迭代次数与判定相交的容差（毫米）；迭代直到g不大于0，容差只用于最后判定，
+    // 因此擦边的射线也能收敛到准确的高度
+    constexpr int NEWTON_STEPS = 16;
+    constexpr float HIT_TOLERANCE = 1e-4f;
+    // 射线在刀具包围盒外开始迭代的余量
+    constexpr float START_MARGIN = 1e-3f;
+
+    // 点到刀具核心圆柱的距离减去圆角半径g(t)及其沿坐标轴dim的导数
+    // g是凸函数，从刀具外一侧开始的牛顿迭代单调逼近最近的根，不会越过
+    inline float toolDistance(const ToolShape &tool, glm::vec3 p, int dim, float &slope)
+    {
+        glm::vec3 w = p - tool.base;
+        float h = glm::dot(w, tool.axis);
+        glm::vec3 r = w - h * tool.axis;
+        float rho = std::sqrt(glm::dot(r, r));
+        float dh = h - std::clamp(h, 0.0f, tool.shank);
+        float drho = std::max(rho - tool.coreRadius, 0.0f);
+        float f = std::sqrt(dh * dh + drho * drho);
+        float dhSlope = dh != 0.0f ? tool.axis[dim] : 0.0f;
+        float drhoSlope = drho > 0.0f ? r[dim] / rho : 0.0f;
+        slope = (dh * dhSlope + drho * drhoSlope) / std::max(f, 1e-12f);
+        return f - tool.corner;
+    }
+
+    // 从start沿坐标轴dim的sign方向逼近刀具表面，返回是否相交
+    bool toolEntry(const ToolShape &tool, glm::vec3 origin, int dim, float start, float sign, float &t)
+    {
+        t = start;
+        for (int step = 0; step < NEWTON_STEPS; step++)
+        {
+            glm::vec3 p = origin;
+            p[dim] = t;
+            float slope;
+            float g = toolDistance(tool, p, dim, slope);
+            if (g <= 0.0f)
+            {
+                return true;
+            }
+            // 沿前进方向g不再减小，说明已越过离刀具最近的位置
+            slope *= sign;
+            if (slope >= 0.0f)
+            {
+                return g <= HIT_TOLERANCE;
+            }
+            t -= sign * g / slope;
+        }
+        glm::vec3 p = origin;
+        p[dim] = t;
+        float slope;
+        return toolDistance(tool, p, dim, slope) <= HIT_TOLERANCE;
+    }
+}
+
+ToolShape makeToolShape(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis)
+{
+    ToolShape tool;
+    float radius = cutter.radius * cutter.precision;
+    tool.axis = glm::normalize(toolAxis);
+    tool.corner = cutter.cornerSize() * cutter.precision;
+    tool.coreRadius = radius - tool.corner;
+    tool.shank = cutter.shankLength * cutter.precision;
+    glm::vec3 centre = (toolPosition + glm::vec3(cutter.middleX, cutter.middleY, cutter.middleZ)) * cutter.precision;
+    // 刀尖沿刀轴上移圆角半径即为核心圆柱的底面中心
+    tool.base = centre - tool.axis * (radius - tool.corner);
+    glm::vec3 top = tool.base + tool.axis * tool.shank;
+    glm::vec3 extent;
+    for (int i = 0; i < 3; i++)
+    {
+        extent[i] = tool.coreRadius * std::sqrt(std::max(0.0f, 1.0f - tool.axis[i] * tool.axis[i])) + tool.corner;
+    }
+    tool.lower = glm::min(tool.base, top) - extent;
+    tool.upper = glm::max(tool.base, top) + extent;
+    return tool;
+}
+
+bool toolInterval(const ToolShape &tool, glm::vec3 origin, int dim, float &t0, float &t1)
+{
+    return toolEntry(tool, origin, dim, tool.lower[dim] - START_MARGIN, 1.0f, t0) &&
+           toolEntry(tool, origin, dim, tool.upper[dim] + START_MARGIN, -1.0f, t1) && t0 < t1;
+}
+
+void toolEnvelope(const ToolShape &tool, float x, float z0, float step, int count, float *lowest)
+{
+    const int LANES = 32;
+    const float inf = std::numeric_limits<float>::infinity();
+    const glm::vec3 u = tool.axis;
+    for (int begin = 0; begin < count; begin += LANES)
+    {
+        int lanes = std::min(LANES, count - begin);
+        float y[LANES];
+        float alive[LANES];
+        for (int j = 0; j < lanes; j++)
+        {
+            y[j] = tool.lower.y - START_MARGIN;
+            alive[j] = 1.0f;
+        }
+        // 与toolDistance相同的计算，按射线展开成无分支形式
+        for (int iteration = 0; iteration <= NEWTON_STEPS; iteration++)
+        {
+            int pending = 0;
+            for (int j = 0; j < lanes; j++)
+            {
+                float wx = x - tool.base.x;
+                float wy = y[j] - tool.base.y;
+                float wz = z0 + float(begin + j) * step - tool.base.z;
+                float h = wx * u.x + wy * u.y + wz * u.z;
+                float ry = wy - h * u.y;
+                float rx = wx - h * u.x;
+                float rz = wz - h * u.z;
+                float rho = std::sqrt(rx * rx + ry * ry + rz * rz);
+                float dh = h - std::min(std::max(h, 0.0f), tool.shank);
+                float drho = std::max(rho - tool.coreRadius, 0.0f);
+                float f = std::sqrt(dh * dh + drho * drho);
+                float g = f - tool.corner;
+                float dhSlope = dh != 0.0f ? u.y : 0.0f;
+                float drhoSlope = drho > 0.0f ? ry / std::max(rho, 1e-12f) : 0.0f;
+                float slope = (dh * dhSlope + drho * drhoSlope) / std::max(f, 1e-12f);
+                // 已经到达表面的射线不再移动，沿+y方向g不再减小或迭代结束仍未到达的射线判为不相交
+                bool moving = alive[j] > 0.0f && g > 0.0f && slope < 0.0f;
+                bool missed = alive[j] > 0.0f && g > HIT_TOLERANCE && (slope >= 0.0f || iteration == NEWTON_STEPS);
+                alive[j] = missed ? 0.0f : alive[j];
+                y[j] = moving && !missed ? y[j] - g / slope : y[j];
+                pending |= int(moving && !missed);
+            }
+            // 所有射线都已到达表面或判为不相交
+            if (!pending)
+            {
+                break;
+            }
+        }
+        for (int j = 0; j < lanes; j++)
+        {
+            lowest[begin + j] = alive[j] > 0.0f ? y[j] : inf;
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "cutter.hpp"
+
+// 任意刀轴方向的球头、平底、牛鼻刀几何（单位为毫米）
+// 刀具为半径coreRadius的圆柱（底面中心base、沿axis长shank）外扩corner的实体：
+// 球头刀coreRadius为0，平底刀corner为0，牛鼻刀两者都大于0
+struct ToolShape
+{
+    glm::vec3 base;
+    glm::vec3 axis;
+    float coreRadius;
+    float corner;
+    float shank;
+    glm::vec3 lower;
+    glm::vec3 upper;
+};
+
+// 由刀位（网格坐标）与刀轴方向生成刀具几何；刀尖位于球头中心沿刀轴向下一个刀具半径处，
+// 因此竖直刀轴的球头刀与Cutter::depthData描述的形状一致
+ToolShape makeToolShape(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis);
+
+// 刀轴是否竖直向上
+inline bool isVerticalAxis(glm::vec3 axis)
+{
+    return axis.x == 0.0f && axis.z == 0.0f && axis.y > 0.0f;
+}
+
+// 过origin、沿坐标轴dim的直线与刀具的交集[t0, t1]（t为该坐标轴上的坐标）
+bool toolInterval(const ToolShape &tool, glm::vec3 origin, int dim, float &t0, float &t1);
+
+// 刀具在一行竖直射线(x, z0 + j * step)上的下包络，即射线与刀具的最低交点高度，未相交时为+inf
+// 各射线之间没有依赖，内层循环对count条射线做相同次数的迭代，便于编译器向量化
+void toolEnvelope(const ToolShape &tool, float x, float z0, float step, int count, float *lowest);
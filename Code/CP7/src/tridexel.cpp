@@ -0,0 +1,697 @@
+#include "tridexel.hpp"
+#include "parallel.hpp"
+#include "toolshape.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // 各方向射线的行所在维度与行内射线所在维度
+    const int rowDim[3] = {1, 0, 0};
+    const int rayDim[3] = {2, 2, 1};
+
+    // 球头刀（核心圆柱半径为0）是胶囊体，直接求出过origin、沿坐标轴axis的直线与它的交集[t0, t1]
+    bool capsuleInterval(const ToolShape &tool, glm::vec3 origin, int axis, float &t0, float &t1)
+    {
+        const float inf = std::numeric_limits<float>::infinity();
+        float lo = inf;
+        float hi = -inf;
+        auto sphere = [&](glm::vec3 centre) {
+            glm::vec3 f = origin - centre;
+            float b = f[axis];
+            float disc = b * b - (glm::dot(f, f) - tool.corner * tool.corner);
+            if (disc >= 0.0f)
+            {
+                float s = std::sqrt(disc);
+                lo = std::min(lo, -b - s);
+                hi = std::max(hi, -b + s);
+            }
+        };
+        sphere(tool.base);
+        sphere(tool.base + tool.axis * tool.shank);
+
+        // 圆柱部分：先求与无限长圆柱的交集，再与两端面之间的平板求交
+        glm::vec3 e(0.0f);
+        e[axis] = 1.0f;
+        glm::vec3 w = origin - tool.base;
+        float du = tool.axis[axis];
+        float wu = glm::dot(w, tool.axis);
+        glm::vec3 m = e - du * tool.axis;
+        glm::vec3 n = w - wu * tool.axis;
+        float A = glm::dot(m, m);
+        float B = 2.0f * glm::dot(n, m);
+        float C = glm::dot(n, n) - tool.corner * tool.corner;
+        float c0 = -inf;
+        float c1 = inf;
+        bool hit = true;
+        if (A < 1e-12f)
+        {
+            hit = C <= 0.0f;
+        }
+        else
+        {
+            float disc = B * B - 4.0f * A * C;
+            hit = disc >= 0.0f;
+            if (hit)
+            {
+                float s = std::sqrt(disc);
+                c0 = (-B - s) / (2.0f * A);
+                c1 = (-B + s) / (2.0f * A);
+            }
+        }
+        if (hit)
+        {
+            if (std::fabs(du) < 1e-12f)
+            {
+                hit = wu >= 0.0f && wu <= tool.shank;
+            }
+            else
+            {
+                float s0 = -wu / du;
+                float s1 = (tool.shank - wu) / du;
+                c0 = std::max(c0, std::min(s0, s1));
+                c1 = std::min(c1, std::max(s0, s1));
+            }
+        }
+        if (hit && c0 < c1)
+        {
+            lo = std::min(lo, c0);
+            hi = std::max(hi, c1);
+        }
+        t0 = lo;
+        t1 = hi;
+        return lo < hi;
+    }
+}
+
+int TriDexel::SegmentPool::allocate(float start, float end, int next)
+{
+    int index;
+    if (freeList != -1)
+    {
+        index = freeList;
+        freeList = segments[index].next;
+    }
+    else
+    {
+        index = int(segments.size());
+        segments.push_back({});
+    }
+    segments[index] = {start, end, next};
+    return index;
+}
+
+void TriDexel::SegmentPool::release(int index)
+{
+    segments[index].next = freeList;
+    freeList = index;
+}
+
+TriDexel::TriDexel(int l, int w, float pres, float bottomDepth, float topDepth)
+    : nx(l), nz(w), precision(pres), bottom(bottomDepth), top(topDepth)
+{
+    ny = int(std::ceil((top - bottom) / precision)) + 1;
+    tilesX = (nx + WorkPiece::TILE_SIZE - 1) / WorkPiece::TILE_SIZE;
+    tilesZ = (nz + WorkPiece::TILE_SIZE - 1) / WorkPiece::TILE_SIZE;
+    tileDirty.assign(size_t(tilesX) * tilesZ, 0);
+    tileMeshes.resize(tileDirty.size());
+    for (int axis = 0; axis < 3; axis++)
+    {
+        DexelGrid &grid = grids[axis];
+        rayGrid(axis, grid.rows, grid.raysPerRow);
+        grid.heads.assign(size_t(grid.rows) * grid.raysPerRow, -1);
+        grid.pools.resize(grid.rows);
+    }
+
+    // 长方体：x、z方向的射线只存在于[bottom, top]之间的高度上
+    float extent[3] = {(nx - 1) * precision, top, (nz - 1) * precision};
+    float origin[3] = {0.0f, bottom, 0.0f};
+    for (int axis = 0; axis < 3; axis++)
+    {
+        DexelGrid &grid = grids[axis];
+        for (int row = 0; row < grid.rows; row++)
+        {
+            for (int ray = 0; ray < grid.raysPerRow; ray++)
+            {
+                float y = bottom + (axis == 0 ? row : ray) * precision;
+                if (axis != 1 && y > top)
+                {
+                    continue;
+                }
+                int last = -1;
+                append(grid.pools[row], head(axis, row, ray), last, origin[axis], extent[axis]);
+            }
+        }
+    }
+}
+
+void TriDexel::rayGrid(int axis, int &rows, int &raysPerRow) const
+{
+    const int counts[3] = {nx, ny, nz};
+    rows = counts[rowDim[axis]];
+    raysPerRow = counts[rayDim[axis]];
+}
+
+void TriDexel::clear()
+{
+    for (DexelGrid &grid : grids)
+    {
+        std::fill(grid.heads.begin(), grid.heads.end(), -1);
+        for (SegmentPool &pool : grid.pools)
+        {
+            pool.segments.clear();
+            pool.freeList = -1;
+        }
+    }
+}
+
+void TriDexel::append(SegmentPool &pool, int &first, int &last, float start, float end)
+{
+    int index = pool.allocate(start, end, -1);
+    if (last == -1)
+    {
+        first = index;
+    }
+    else
+    {
+        pool.segments[last].next = index;
+    }
+    last = index;
+}
+
+void TriDexel::initFromWorkpiece(const WorkPiece &workpiece)
+{
+    clear();
+    int lx = std::min(nx, workpiece.length);
+    int lz = std::min(nz, workpiece.width);
+    auto height = [&](int x, int z) { return std::min(workpiece.getDepth(x, z), top); };
+
+    // y方向：每条射线只有[bottom, 顶面高度]一段
+    parallelFor(lx, [&](int i) {
+        for (int k = 0; k < lz; k++)
+        {
+            float h = height(i, k);
+            if (h > bottom)
+            {
+                int last = -1;
+                append(grids[1].pools[i], head(1, i, k), last, bottom, h);
+            }
+        }
+    });
+
+    // x、z方向：沿射线依次比较顶面高度与射线高度，在相邻网格点之间线性插值出交点
+    auto scan = [&](SegmentPool &pool, int &first, float y, int count, auto &&sample) {
+        int last = -1;
+        float start = 0.0f;
+        bool inside = sample(0) >= y;
+        for (int i = 0; i + 1 < count; i++)
+        {
+            float h0 = sample(i);
+            float h1 = sample(i + 1);
+            bool next = h1 >= y;
+            if (next != inside)
+            {
+                float t = (y - h0) / (h1 - h0);
+                float crossing = (i + std::clamp(t, 0.0f, 1.0f)) * precision;
+                if (next)
+                {
+                    start = crossing;
+                }
+                else
+                {
+                    append(pool, first, last, start, crossing);
+                }
+                inside = next;
+            }
+        }
+        if (inside)
+        {
+            append(pool, first, last, start, (count - 1) * precision);
+        }
+    };
+    parallelFor(ny, [&](int j) {
+        float y = bottom + j * precision;
+        for (int k = 0; k < lz; k++)
+        {
+            scan(grids[0].pools[j], head(0, j, k), y, lx, [&](int i) { return height(i, k); });
+        }
+    });
+    parallelFor(lx, [&](int i) {
+        for (int j = 0; j < ny; j++)
+        {
+            float y = bottom + j * precision;
+            scan(grids[2].pools[i], head(2, i, j), y, lz, [&](int k) { return height(i, k); });
+        }
+    });
+    std::fill(tileDirty.begin(), tileDirty.end(), 1);
+}
+
+bool TriDexel::isInside(int x, float y, int z) const
+{
+    const DexelGrid &grid = grids[1];
+    const SegmentPool &pool = grid.pools[x];
+    for (int s = grid.heads[x * grid.raysPerRow + z]; s != -1; s = pool.segments[s].next)
+    {
+        const Segment &seg = pool.segments[s];
+        if (seg.start > y)
+        {
+            break;
+        }
+        if (y <= seg.end)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TriDexel::subtract(SegmentPool &pool, int &first, float start, float end)
+{
+    bool changed = false;
+    int *link = &first;
+    while (*link != -1)
+    {
+        int index = *link;
+        Segment &seg = pool.segments[index];
+        if (seg.start >= end)
+        {
+            break;
+        }
+        if (seg.end <= start)
+        {
+            link = &seg.next;
+            continue;
+        }
+        changed = true;
+        if (seg.start >= start && seg.end <= end)
+        {
+            // 整段被切除
+            *link = seg.next;
+            pool.release(index);
+        }
+        else if (seg.start < start && seg.end > end)
+        {
+            // 被切成两段；allocate可能使seg失效，之后只通过下标访问
+            float oldEnd = seg.end;
+            seg.end = start;
+            int split = pool.allocate(end, oldEnd, seg.next);
+            pool.segments[index].next = split;
+            break;
+        }
+        else if (seg.start < start)
+        {
+            seg.end = start;
+            link = &seg.next;
+        }
+        else
+        {
+            seg.start = end;
+            break;
+        }
+    }
+    return changed;
+}
+
+bool TriDexel::stampCutter(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis)
+{
+    return stampPath(cutter, {toolPosition}, {toolAxis});
+}
+
+bool TriDexel::stampPath(const Cutter &cutter, const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &axes)
+{
+    if (positions.empty())
+    {
+        return false;
+    }
+    std::vector<ToolShape> tools;
+    tools.reserve(positions.size());
+    glm::vec3 lower(std::numeric_limits<float>::max());
+    glm::vec3 upper(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        tools.push_back(makeToolShape(cutter, positions[i], axes.empty() ? glm::vec3(0.0f, 1.0f, 0.0f) : axes[i]));
+        lower = glm::min(lower, tools.back().lower);
+        upper = glm::max(upper, tools.back().upper);
+    }
+
+    // 坐标区间[lo, hi]覆盖的网格点下标范围
+    const float origin[3] = {0.0f, bottom, 0.0f};
+    const int counts[3] = {nx, ny, nz};
+    auto nodeRange = [&](int dim, float lo, float hi, int &i0, int &i1) {
+        i0 = std::max(0, int(std::ceil((lo - origin[dim]) / precision)));
+        i1 = std::min(counts[dim] - 1, int(std::floor((hi - origin[dim]) / precision)));
+    };
+
+    // 所有刀位共同覆盖的(方向, 行)作为并行任务
+    struct Task
+    {
+        int axis;
+        int row;
+        // 被修改的x、z网格范围
+        int x0, x1, z0, z1;
+    };
+    std::vector<Task> tasks;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        int r0, r1;
+        nodeRange(rowDim[axis], lower[rowDim[axis]], upper[rowDim[axis]], r0, r1);
+        for (int row = r0; row <= r1; row++)
+        {
+            tasks.push_back({axis, row, nx, -1, nz, -1});
+        }
+    }
+
+    int grain = std::max(1, int(tasks.size()) / (workerCount() * 4));
+    parallelFor(
+        int(tasks.size()),
+        [&](int t) {
+            Task &task = tasks[t];
+            int axis = task.axis;
+            int rd = rowDim[axis];
+            int sd = rayDim[axis];
+            SegmentPool &pool = grids[axis].pools[task.row];
+            glm::vec3 rayOrigin(0.0f);
+            rayOrigin[rd] = origin[rd] + task.row * precision;
+            for (const ToolShape &tool : tools)
+            {
+                if (rayOrigin[rd] < tool.lower[rd] || rayOrigin[rd] > tool.upper[rd])
+                {
+                    continue;
+                }
+                int s0, s1;
+                nodeRange(sd, tool.lower[sd], tool.upper[sd], s0, s1);
+                for (int ray = s0; ray <= s1; ray++)
+                {
+                    rayOrigin[sd] = origin[sd] + ray * precision;
+                    float t0, t1;
+                    bool hit = tool.coreRadius > 0.0f ? toolInterval(tool, rayOrigin, axis, t0, t1) : capsuleInterval(tool, rayOrigin, axis, t0, t1);
+                    if (!hit || !subtract(pool, head(axis, task.row, ray), t0, t1))
+                    {
+                        continue;
+                    }
+                    // 记录被修改的xz范围
+                    // x方向射线的行内序号为z下标；y、z方向射线的行号为x下标
+                    int i0 = axis == 0 ? int(std::floor(t0 / precision)) : task.row;
+                    int i1 = axis == 0 ? int(std::ceil(t1 / precision)) : task.row;
+                    int k0 = axis == 2 ? int(std::floor(t0 / precision)) : ray;
+                    int k1 = axis == 2 ? int(std::ceil(t1 / precision)) : ray;
+                    task.x0 = std::min(task.x0, i0);
+                    task.x1 = std::max(task.x1, i1);
+                    task.z0 = std::min(task.z0, k0);
+                    task.z1 = std::max(task.z1, k1);
+                }
+            }
+        },
+        grain);
+
+    bool changed = false;
+    for (const Task &task : tasks)
+    {
+        if (task.x0 > task.x1)
+        {
+            continue;
+        }
+        changed = true;
+        int x0 = std::clamp(task.x0, 0, nx - 1) / WorkPiece::TILE_SIZE;
+        int x1 = std::clamp(task.x1, 0, nx - 1) / WorkPiece::TILE_SIZE;
+        int z0 = std::clamp(task.z0, 0, nz - 1) / WorkPiece::TILE_SIZE;
+        int z1 = std::clamp(task.z1, 0, nz - 1) / WorkPiece::TILE_SIZE;
+        for (int tx = x0; tx <= x1; tx++)
+        {
+            for (int tz = z0; tz <= z1; tz++)
+            {
+                tileDirty[tx * tilesZ + tz] = 1;
+            }
+        }
+    }
+    return changed;
+}
+
+std::vector<int> TriDexel::takeDirtyTiles()
+{
+    std::vector<int> tiles;
+    for (int tile = 0; tile < int(tileDirty.size()); tile++)
+    {
+        if (tileDirty[tile])
+        {
+            tiles.push_back(tile);
+            tileDirty[tile] = 0;
+        }
+    }
+    return tiles;
+}
+
+void TriDexel::tileNodes(int tile, int &px0, int &px1, int &pz0, int &pz1) const
+{
+    // 扩展后的下标p对应原网格点p - 1，分块按原网格点划分
+    int tx = tile / tilesZ;
+    int tz = tile % tilesZ;
+    px0 = tx == 0 ? 0 : tx * WorkPiece::TILE_SIZE + 1;
+    px1 = tx == tilesX - 1 ? nx + 1 : (tx + 1) * WorkPiece::TILE_SIZE;
+    pz0 = tz == 0 ? 0 : tz * WorkPiece::TILE_SIZE + 1;
+    pz1 = tz == tilesZ - 1 ? nz + 1 : (tz + 1) * WorkPiece::TILE_SIZE;
+}
+
+void TriDexel::tileBounds(int tile, glm::vec3 &lower, glm::vec3 &upper) const
+{
+    // 分块的四边形引用到下标p - 1的单元，顶点都在这些单元之内
+    int px0, px1, pz0, pz1;
+    tileNodes(tile, px0, px1, pz0, pz1);
+    lower = glm::vec3((std::max(px0 - 1, 0) - 1) * precision, bottom - precision, (std::max(pz0 - 1, 0) - 1) * precision);
+    upper = glm::vec3(std::min(px1, nx) * precision, bottom + ny * precision, std::min(pz1, nz) * precision);
+}
+
+void TriDexel::buildMesh(std::vector<float> &coords, std::vector<int> &indices)
+{
+    parallelFor(int(tileMeshes.size()), [&](int tile) { buildTileMesh(tile); });
+    gatherMesh(coords, indices);
+}
+
+std::vector<int> TriDexel::updateMesh(const std::vector<int> &tiles, std::vector<float> &coords, std::vector<int> &indices)
+{
+    // 单元顶点用到单元外一层网格点上的区间端点，分块边界附近的修改也会改变相邻分块的网格
+    std::vector<uint8_t> rebuild(tileMeshes.size(), 0);
+    for (int tile : tiles)
+    {
+        int tx = tile / tilesZ;
+        int tz = tile % tilesZ;
+        for (int x = std::max(tx - 1, 0); x <= std::min(tx + 1, tilesX - 1); x++)
+        {
+            for (int z = std::max(tz - 1, 0); z <= std::min(tz + 1, tilesZ - 1); z++)
+            {
+                rebuild[x * tilesZ + z] = 1;
+            }
+        }
+    }
+    std::vector<int> rebuilt;
+    for (int tile = 0; tile < int(rebuild.size()); tile++)
+    {
+        if (rebuild[tile])
+        {
+            rebuilt.push_back(tile);
+        }
+    }
+    parallelFor(int(rebuilt.size()), [&](int n) { buildTileMesh(rebuilt[n]); });
+    gatherMesh(coords, indices);
+    return rebuilt;
+}
+
+void TriDexel::gatherMesh(std::vector<float> &coords, std::vector<int> &indices) const
+{
+    size_t coordCount = 0;
+    size_t indexCount = 0;
+    for (const TileMesh &mesh : tileMeshes)
+    {
+        coordCount += mesh.coords.size();
+        indexCount += mesh.indices.size();
+    }
+    coords.clear();
+    coords.reserve(coordCount);
+    indices.clear();
+    indices.reserve(indexCount);
+    for (const TileMesh &mesh : tileMeshes)
+    {
+        int offset = int(coords.size() / 3);
+        coords.insert(coords.end(), mesh.coords.begin(), mesh.coords.end());
+        for (int index : mesh.indices)
+        {
+            indices.push_back(index + offset);
+        }
+    }
+}
+
+void TriDexel::buildTileMesh(int tile)
+{
+    // 网格点向外各扩展一层（视为材料外），保证生成的网格是封闭的
+    const int dims[3] = {nx + 2, ny + 2, nz + 2};
+    const int cells[3] = {dims[0] - 1, dims[1] - 1, dims[2] - 1};
+    const float origin[3] = {0.0f, bottom, 0.0f};
+    // 扩展后的网格点下标p对应的坐标
+    auto nodeCoord = [&](int dim, int p) { return origin[dim] + (p - 1) * precision; };
+
+    // 分块生成以[px0, px1] x [pz0, pz1]内的网格点为起点的边上的四边形，
+    // 它们引用[px0 - 1, px1]内的单元，这些单元的角点在[px0 - 1, px1 + 1]内
+    int px0, px1, pz0, pz1;
+    tileNodes(tile, px0, px1, pz0, pz1);
+    int cx0 = std::max(px0 - 1, 0);
+    int cx1 = std::min(px1, cells[0] - 1);
+    int cz0 = std::max(pz0 - 1, 0);
+    int cz1 = std::min(pz1, cells[2] - 1);
+    int ix1 = std::min(px1 + 1, dims[0] - 1);
+    int iz1 = std::min(pz1 + 1, dims[2] - 1);
+    const int span[3] = {ix1 - cx0 + 1, dims[1], iz1 - cz0 + 1};
+    auto nodeIndex = [&](int i, int j, int k) { return (size_t(i - cx0) * span[1] + j) * span[2] + (k - cz0); };
+
+    // 网格点是否在材料内，由y方向射线确定
+    std::vector<uint8_t> inside(size_t(span[0]) * span[1] * span[2], 0);
+    for (int i = std::max(cx0, 1); i <= std::min(ix1, nx); i++)
+    {
+        const DexelGrid &grid = grids[1];
+        const SegmentPool &pool = grid.pools[i - 1];
+        for (int k = std::max(cz0, 1); k <= std::min(iz1, nz); k++)
+        {
+            int s = grid.heads[(i - 1) * grid.raysPerRow + (k - 1)];
+            for (int j = 0; j < ny; j++)
+            {
+                float y = bottom + j * precision;
+                while (s != -1 && pool.segments[s].end < y)
+                {
+                    s = pool.segments[s].next;
+                }
+                inside[nodeIndex(i, j + 1, k)] = s != -1 && pool.segments[s].start <= y;
+            }
+        }
+    }
+
+    // 网格点p到p + e_axis的边与表面的交点坐标，优先使用该边所在射线上的区间端点
+    auto crossing = [&](int axis, const int p[3]) {
+        float c0 = nodeCoord(axis, p[axis]);
+        float c1 = c0 + precision;
+        bool leaving = inside[nodeIndex(p[0], p[1], p[2])] != 0;
+        const DexelGrid &grid = grids[axis];
+        int row = p[rowDim[axis]] - 1;
+        int ray = p[rayDim[axis]] - 1;
+        if (row >= 0 && row < grid.rows && ray >= 0 && ray < grid.raysPerRow)
+        {
+            const SegmentPool &pool = grid.pools[row];
+            const float eps = precision * 1e-3f;
+            for (int s = grid.heads[row * grid.raysPerRow + ray]; s != -1; s = pool.segments[s].next)
+            {
+                const Segment &seg = pool.segments[s];
+                float value = leaving ? seg.end : seg.start;
+                if (value >= c0 - eps && value <= c1 + eps)
+                {
+                    return std::clamp(value, c0, c1);
+                }
+                if (seg.start > c1)
+                {
+                    break;
+                }
+            }
+        }
+        return (c0 + c1) * 0.5f;
+    };
+
+    // 每个单元（以其最小角的网格点编号）在表面穿过时生成一个顶点，位置为各条穿过边上交点的平均值
+    auto cellActive = [&](int i, int j, int k) {
+        uint8_t first = inside[nodeIndex(i, j, k)];
+        for (int c = 1; c < 8; c++)
+        {
+            if (inside[nodeIndex(i + (c & 1), j + ((c >> 1) & 1), k + ((c >> 2) & 1))] != first)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    const int cellSpan = cz1 - cz0 + 1;
+    auto cellIndex = [&](int i, int j, int k) { return (size_t(i - cx0) * cells[1] + j) * cellSpan + (k - cz0); };
+    TileMesh &mesh = tileMeshes[tile];
+    mesh.coords.clear();
+    mesh.indices.clear();
+    std::vector<int> cellVertex(size_t(cx1 - cx0 + 1) * cells[1] * cellSpan, -1);
+    int vertex = 0;
+    for (int i = cx0; i <= cx1; i++)
+    {
+        for (int j = 0; j < cells[1]; j++)
+        {
+            for (int k = cz0; k <= cz1; k++)
+            {
+                if (!cellActive(i, j, k))
+                {
+                    continue;
+                }
+                glm::vec3 sum(0.0f);
+                int hits = 0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    int u = (axis + 1) % 3;
+                    int v = (axis + 2) % 3;
+                    for (int e = 0; e < 4; e++)
+                    {
+                        int p[3] = {i, j, k};
+                        p[u] += e & 1;
+                        p[v] += e >> 1;
+                        int q[3] = {p[0], p[1], p[2]};
+                        q[axis]++;
+                        if (inside[nodeIndex(p[0], p[1], p[2])] == inside[nodeIndex(q[0], q[1], q[2])])
+                        {
+                            continue;
+                        }
+                        glm::vec3 point(nodeCoord(0, p[0]), nodeCoord(1, p[1]), nodeCoord(2, p[2]));
+                        point[axis] = crossing(axis, p);
+                        sum += point;
+                        hits++;
+                    }
+                }
+                glm::vec3 position = sum / float(hits);
+                mesh.coords.insert(mesh.coords.end(), {position.x, position.y, position.z});
+                cellVertex[cellIndex(i, j, k)] = vertex++;
+            }
+        }
+    }
+
+    // 每条穿过表面的边由周围四个单元的顶点组成一个四边形，法线指向材料外
+    for (int i = px0; i <= px1; i++)
+    {
+        for (int j = 0; j < dims[1]; j++)
+        {
+            for (int k = pz0; k <= pz1; k++)
+            {
+                int p[3] = {i, j, k};
+                bool in = inside[nodeIndex(i, j, k)] != 0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    if (p[axis] + 1 >= dims[axis])
+                    {
+                        continue;
+                    }
+                    int q[3] = {i, j, k};
+                    q[axis]++;
+                    if (in == (inside[nodeIndex(q[0], q[1], q[2])] != 0))
+                    {
+                        continue;
+                    }
+                    int u = (axis + 1) % 3;
+                    int v = (axis + 2) % 3;
+                    int c[4];
+                    const int offsets[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+                    for (int n = 0; n < 4; n++)
+                    {
+                        int r[3] = {i, j, k};
+                        r[u] -= offsets[n][0];
+                        r[v] -= offsets[n][1];
+                        c[n] = cellVertex[cellIndex(r[0], r[1], r[2])];
+                    }
+                    // 材料在p一侧时法线为+axis方向，按c0、c1、c2、c3逆时针
+                    if (!in)
+                    {
+                        std::swap(c[1], c[3]);
+                    }
+                    mesh.indices.insert(mesh.indices.end(), {c[0], c[1], c[2], c[0], c[2], c[3]});
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "cutter.hpp"
+#include "stock.hpp"
+#include "workpiece.hpp"
+
+// 三向dexel毛坯：沿x、y、z三个方向各有一组平行射线，每条射线上保存若干材料区间
+// 与只记录顶面高度的Z-map不同，它可以表示倒扣、侧壁上的凹槽等结构
+class TriDexel : public Stock
+{
+public:
+    // 射线上的一段材料[start, end]，next为同一射线上的下一段（按start升序），-1表示结束
+    struct Segment
+    {
+        float start;
+        float end;
+        int next;
+    };
+
+    // 一行射线共用的区间池，被删除的区间进入空闲链表复用，不会为每条射线单独分配内存
+    struct SegmentPool
+    {
+        std::vector<Segment> segments;
+        int freeList = -1;
+
+        int allocate(float start, float end, int next);
+        void release(int index);
+    };
+
+    // 同一方向的所有射线，按行划分，每行一个区间池，不同行可以并行修改
+    struct DexelGrid
+    {
+        int rows = 0;
+        int raysPerRow = 0;
+        std::vector<int> heads;
+        std::vector<SegmentPool> pools;
+    };
+
+    // x、z方向的网格点数与精度，和WorkPiece的length、width、precision含义相同
+    int nx;
+    int nz;
+    // y方向网格点数，网格点高度为bottom + j * precision
+    int ny;
+    float precision;
+    float bottom;
+    float top;
+    int tilesX;
+    int tilesZ;
+    std::vector<uint8_t> tileDirty;
+    // 0、1、2分别为沿x、y、z方向的射线
+    DexelGrid grids[3];
+    // 各分块的网格，顶点索引从该分块的第一个顶点开始；分块边界上的顶点在两侧各存一份
+    struct TileMesh
+    {
+        std::vector<float> coords;
+        std::vector<int> indices;
+    };
+    std::vector<TileMesh> tileMeshes;
+
+    // 生成[0, (l-1)*pres] x [bottomDepth, topDepth] x [0, (w-1)*pres]的长方体毛坯
+    TriDexel(int l, int w, float pres, float bottomDepth, float topDepth);
+
+    // 用Z-map的顶面高度重新生成毛坯，底面为bottom
+    void initFromWorkpiece(const WorkPiece &workpiece);
+
+    // 射线上的材料区间链表头，行号与行内序号见grids的说明
+    inline int &head(int axis, int row, int ray)
+    {
+        return grids[axis].heads[row * grids[axis].raysPerRow + ray];
+    }
+
+    // 点(x, y, z)（毫米）是否在材料内，使用y方向射线判断
+    bool isInside(int x, float y, int z) const;
+
+    using Stock::stampCutter;
+
+    // 刀具按其几何（含Cutter::shankLength长的刀杆）切除材料，刀轴可以任意倾斜
+    bool stampCutter(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis) override;
+
+    // 整批刀位按(方向, 行)划分给多个线程，每行内按刀位顺序依次做布尔减
+    bool stampPath(const Cutter &cutter, const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &axes) override;
+
+    std::vector<int> takeDirtyTiles() override;
+
+    // 用Surface Nets从三组射线生成封闭的三角网格，网格按分块分别生成后拼接
+    void buildMesh(std::vector<float> &coords, std::vector<int> &indices) override;
+
+    // 只重新生成tiles及其相邻分块的网格，再拼接所有分块的网格，返回重新生成的分块
+    std::vector<int> updateMesh(const std::vector<int> &tiles, std::vector<float> &coords, std::vector<int> &indices);
+
+    // 分块网格所在的包围盒（毫米）
+    void tileBounds(int tile, glm::vec3 &lower, glm::vec3 &upper) const;
+
+private:
+    // 从射线上减去区间[start, end]，返回是否有材料被删除
+    bool subtract(SegmentPool &pool, int &first, float start, float end);
+    // 在射线上追加一段材料，调用方保证按start升序追加
+    void append(SegmentPool &pool, int &first, int &last, float start, float end);
+    void clear();
+    // 第axis方向的射线在其余两个方向上的网格点数
+    void rayGrid(int axis, int &rows, int &raysPerRow) const;
+    // 分块拥有的网格点范围（向外扩展一层后的下标），最外层扩展的网格点归属边上的分块
+    void tileNodes(int tile, int &px0, int &px1, int &pz0, int &pz1) const;
+    // 重新生成一个分块的网格
+    void buildTileMesh(int tile);
+    // 拼接所有分块的网格
+    void gatherMesh(std::vector<float> &coords, std::vector<int> &indices) const;
+};
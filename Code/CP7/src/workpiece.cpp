@@ -1,4 +1,8 @@
 #include "workpiece.hpp"
+#include "toolshape.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 
 void PushData(std::vector<float> &data, int x, int z, float precion, float depth)
@@ -8,9 +12,407 @@ void PushData(std::vector<float> &data, int x, int z, float precion, float depth
     data.push_back(float(z) * precion);
 }
 
+WorkPiece::WorkPiece(int l, int w, float pres, HeightFormat fmt, float unit)
+    : length(l), width(w), precision(pres), format(HeightFormat::Float), heightUnit(unit),
+      tilesX((l + TILE_SIZE - 1) / TILE_SIZE), tilesZ((w + TILE_SIZE - 1) / TILE_SIZE),
+      depthData(w * l, 0.0f), tileDirty(tilesX * tilesZ, 0)
+{
+    setFormat(fmt);
+}
+
+int32_t WorkPiece::quantize(float depth) const
+{
+    double q = std::round(double(depth) / double(heightUnit));
+    return int32_t(std::clamp(q, double(INT32_MIN), double(INT32_MAX)));
+}
+
+void WorkPiece::tileBounds(int tile, int &x0, int &x1, int &z0, int &z1) const
+{
+    x0 = (tile / tilesZ) * TILE_SIZE;
+    z0 = (tile % tilesZ) * TILE_SIZE;
+    x1 = std::min(x0 + TILE_SIZE, length);
+    z1 = std::min(z0 + TILE_SIZE, width);
+}
+
+void WorkPiece::setFormat(HeightFormat fmt)
+{
+    // 先统一转换成浮点，再按新格式存储
+    std::vector<float> depths(length * width);
+    for (int x = 0; x < length; x++)
+    {
+        for (int z = 0; z < width; z++)
+        {
+            depths[x * width + z] = getDepth(x, z);
+        }
+    }
+    depthData = {};
+    fixedData32 = {};
+    fixedData16 = {};
+    tileBase = {};
+    format = fmt;
+
+    if (fmt == HeightFormat::Float)
+    {
+        depthData = std::move(depths);
+    }
+    else if (fmt == HeightFormat::Fixed32)
+    {
+        fixedData32.resize(depths.size());
+        for (size_t i = 0; i < depths.size(); i++)
+        {
+            fixedData32[i] = quantize(depths[i]);
+        }
+    }
+    else
+    {
+        // 每个分块以块内最高点为上界确定基准值，向下可表示65535个量化单位
+        fixedData16.resize(depths.size());
+        tileBase.resize(tilesX * tilesZ);
+        for (int tile = 0; tile < tilesX * tilesZ; tile++)
+        {
+            int x0, x1, z0, z1;
+            tileBounds(tile, x0, x1, z0, z1);
+            int32_t maxValue = INT32_MIN;
+            for (int x = x0; x < x1; x++)
+            {
+                for (int z = z0; z < z1; z++)
+                {
+                    maxValue = std::max(maxValue, quantize(depths[x * width + z]));
+                }
+            }
+            int32_t base = int32_t(std::max<int64_t>(int64_t(maxValue) - INT16_MAX, INT32_MIN));
+            tileBase[tile] = base;
+            for (int x = x0; x < x1; x++)
+            {
+                for (int z = z0; z < z1; z++)
+                {
+                    int64_t value = int64_t(quantize(depths[x * width + z])) - base;
+                    fixedData16[x * width + z] = int16_t(std::max<int64_t>(value, INT16_MIN));
+                }
+            }
+        }
+    }
+    std::fill(tileDirty.begin(), tileDirty.end(), 1);
+}
+
+void WorkPiece::rebaseTile(int tile, int32_t minValue)
+{
+    int x0, x1, z0, z1;
+    tileBounds(tile, x0, x1, z0, z1);
+    int32_t oldBase = tileBase[tile];
+    int32_t maxValue = INT32_MIN;
+    for (int x = x0; x < x1; x++)
+    {
+        for (int z = z0; z < z1; z++)
+        {
+            maxValue = std::max(maxValue, oldBase + fixedData16[x * width + z]);
+            minValue = std::min(minValue, oldBase + fixedData16[x * width + z]);
+        }
+    }
+    // 优先保留块内最高点；块内高差超过16位范围时让最低点可表示，高出范围的点被截断
+    int64_t base = int64_t(maxValue) - INT16_MAX;
+    if (int64_t(minValue) - base < INT16_MIN)
+    {
+        base = int64_t(minValue) - INT16_MIN;
+    }
+    tileBase[tile] = int32_t(base);
+    for (int x = x0; x < x1; x++)
+    {
+        for (int z = z0; z < z1; z++)
+        {
+            int64_t value = int64_t(oldBase) + fixedData16[x * width + z] - base;
+            fixedData16[x * width + z] = int16_t(std::clamp<int64_t>(value, INT16_MIN, INT16_MAX));
+        }
+    }
+}
+
+void WorkPiece::setDepth(int x, int z, float depth)
+{
+    int index = x * width + z;
+    switch (format)
+    {
+    case HeightFormat::Fixed32:
+        fixedData32[index] = quantize(depth);
+        break;
+    case HeightFormat::Fixed16:
+    {
+        int tile = tileIndex(x, z);
+        int32_t value = quantize(depth);
+        if (int64_t(value) - tileBase[tile] < INT16_MIN)
+        {
+            rebaseTile(tile, value);
+        }
+        int64_t local = int64_t(value) - tileBase[tile];
+        fixedData16[index] = int16_t(std::clamp<int64_t>(local, INT16_MIN, INT16_MAX));
+        break;
+    }
+    default:
+        depthData[index] = depth;
+        break;
+    }
+    tileDirty[tileIndex(x, z)] = 1;
+}
+
+void WorkPiece::markDirty(int x0, int x1, int z0, int z1)
+{
+    if (x0 >= x1 || z0 >= z1)
+    {
+        return;
+    }
+    for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; tx++)
+    {
+        for (int tz = z0 / TILE_SIZE; tz <= (z1 - 1) / TILE_SIZE; tz++)
+        {
+            tileDirty[tx * tilesZ + tz] = 1;
+        }
+    }
+}
+
+std::vector<int> WorkPiece::takeDirtyTiles()
+{
+    std::vector<int> tiles;
+    for (int tile = 0; tile < int(tileDirty.size()); tile++)
+    {
+        if (tileDirty[tile])
+        {
+            tiles.push_back(tile);
+            tileDirty[tile] = 0;
+        }
+    }
+    return tiles;
+}
+
+bool WorkPiece::stampCutter(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis)
+{
+    if (cutter.shape != CutterShape::Ball || !isVerticalAxis(toolAxis))
+    {
+        return stampTool(cutter, toolPosition, toolAxis);
+    }
+    int px = int(std::lround(toolPosition.x));
+    int pz = int(std::lround(toolPosition.z));
+    float offsetY = toolPosition.y * cutter.precision;
+
+    // 预先把刀具轮廓裁剪到工件范围内，内层循环不再做越界判断
+    int x0 = std::max(0, px);
+    int x1 = std::min(px + cutter.width, length);
+    int z0 = std::max(0, pz);
+    int z1 = std::min(pz + cutter.length, width);
+    if (x0 >= x1 || z0 >= z1)
+    {
+        return false;
+    }
+
+    // 定点格式使用整数轮廓；轮廓的量化单位与工件不一致时临时重新量化
+    const int32_t *fixedProfile = nullptr;
+    int32_t fixedMin = 0;
+    int32_t offsetQ = 0;
+    std::vector<int32_t> requantized;
+    if (format != HeightFormat::Float)
+    {
+        if (cutter.fixedUnit == heightUnit && cutter.fixedDepth.size() == cutter.depthData.size())
+        {
+            fixedProfile = cutter.fixedDepth.data();
+            fixedMin = cutter.fixedMin;
+        }
+        else
+        {
+            requantized.resize(cutter.depthData.size());
+            fixedMin = INT32_MAX;
+            for (size_t i = 0; i < requantized.size(); i++)
+            {
+                requantized[i] = quantize(cutter.depthData[i]);
+                fixedMin = std::min(fixedMin, requantized[i]);
+            }
+            fixedProfile = requantized.data();
+        }
+        offsetQ = quantize(offsetY);
+    }
+
+    bool changed = false;
+    // 按分块处理，只有实际被修改的分块才被标记
+    for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; tx++)
+    {
+        int bx0 = std::max(x0, tx * TILE_SIZE);
+        int bx1 = std::min(x1, (tx + 1) * TILE_SIZE);
+        for (int tz = z0 / TILE_SIZE; tz <= (z1 - 1) / TILE_SIZE; tz++)
+        {
+            int tile = tx * tilesZ + tz;
+            int bz0 = std::max(z0, tz * TILE_SIZE);
+            int bz1 = std::min(z1, (tz + 1) * TILE_SIZE);
+            int count = bz1 - bz0;
+            bool tileChanged = false;
+
+            if (format == HeightFormat::Float)
+            {
+                for (int x = bx0; x < bx1; x++)
+                {
+                    float *row = &depthData[x * width + bz0];
+                    const float *profile = &cutter.depthData[(x - px) * cutter.length + (bz0 - pz)];
+                    for (int j = 0; j < count; j++)
+                    {
+                        float depth = profile[j] + offsetY;
+                        if (row[j] > depth)
+                        {
+                            row[j] = depth;
+                            tileChanged = true;
+                        }
+                    }
+                }
+            }
+            else if (format == HeightFormat::Fixed32)
+            {
+                for (int x = bx0; x < bx1; x++)
+                {
+                    int32_t *row = &fixedData32[x * width + bz0];
+                    const int32_t *profile = &fixedProfile[(x - px) * cutter.length + (bz0 - pz)];
+                    int32_t lowered = 0;
+                    // 无分支的整数最小值，便于编译器向量化
+                    for (int j = 0; j < count; j++)
+                    {
+                        int32_t depth = profile[j] + offsetQ;
+                        lowered |= int32_t(depth < row[j]);
+                        row[j] = std::min(row[j], depth);
+                    }
+                    tileChanged |= lowered != 0;
+                }
+            }
+            else
+            {
+                // 刀具最低点在本块基准下溢出时先调整基准，保证内层循环不会溢出
+                if (int64_t(fixedMin) + offsetQ - tileBase[tile] < INT16_MIN)
+                {
+                    rebaseTile(tile, fixedMin + offsetQ);
+                }
+                int32_t base = tileBase[tile];
+                for (int x = bx0; x < bx1; x++)
+                {
+                    int16_t *row = &fixedData16[x * width + bz0];
+                    const int32_t *profile = &fixedProfile[(x - px) * cutter.length + (bz0 - pz)];
+                    int32_t lowered = 0;
+                    for (int j = 0; j < count; j++)
+                    {
+                        int32_t depth = profile[j] + offsetQ - base;
+                        int32_t current = row[j];
+                        lowered |= int32_t(depth < current);
+                        row[j] = int16_t(std::min(current, depth));
+                    }
+                    tileChanged |= lowered != 0;
+                }
+            }
+
+            if (tileChanged)
+            {
+                tileDirty[tile] = 1;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+bool WorkPiece::stampTool(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis)
+{
+    ToolShape tool = makeToolShape(cutter, toolPosition, toolAxis);
+    int x0 = std::max(0, int(std::ceil(tool.lower.x / precision)));
+    int x1 = std::min(length, int(std::floor(tool.upper.x / precision)) + 1);
+    int z0 = std::max(0, int(std::ceil(tool.lower.z / precision)));
+    int z1 = std::min(width, int(std::floor(tool.upper.z / precision)) + 1);
+    if (x0 >= x1 || z0 >= z1)
+    {
+        return false;
+    }
+
+    bool changed = false;
+    envelope.resize(TILE_SIZE * TILE_SIZE);
+    for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; tx++)
+    {
+        int bx0 = std::max(x0, tx * TILE_SIZE);
+        int bx1 = std::min(x1, (tx + 1) * TILE_SIZE);
+        for (int tz = z0 / TILE_SIZE; tz <= (z1 - 1) / TILE_SIZE; tz++)
+        {
+            int tile = tx * tilesZ + tz;
+            int bz0 = std::max(z0, tz * TILE_SIZE);
+            int bz1 = std::min(z1, (tz + 1) * TILE_SIZE);
+            int count = bz1 - bz0;
+
+            // 先求出整块的下包络，未与刀具相交的网格为+inf
+            float lowest = std::numeric_limits<float>::infinity();
+            for (int x = bx0; x < bx1; x++)
+            {
+                float *row = &envelope[(x - bx0) * TILE_SIZE];
+                toolEnvelope(tool, x * precision, bz0 * precision, precision, count, row);
+                for (int j = 0; j < count; j++)
+                {
+                    lowest = std::min(lowest, row[j]);
+                }
+            }
+            if (std::isinf(lowest))
+            {
+                continue;
+            }
+
+            bool tileChanged = false;
+            if (format == HeightFormat::Float)
+            {
+                for (int x = bx0; x < bx1; x++)
+                {
+                    float *row = &depthData[x * width + bz0];
+                    const float *profile = &envelope[(x - bx0) * TILE_SIZE];
+                    for (int j = 0; j < count; j++)
+                    {
+                        if (row[j] > profile[j])
+                        {
+                            row[j] = profile[j];
+                            tileChanged = true;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                if (format == HeightFormat::Fixed16 && int64_t(quantize(lowest)) - tileBase[tile] < INT16_MIN)
+                {
+                    rebaseTile(tile, quantize(lowest));
+                }
+                for (int x = bx0; x < bx1; x++)
+                {
+                    const float *profile = &envelope[(x - bx0) * TILE_SIZE];
+                    for (int j = 0; j < count; j++)
+                    {
+                        if (std::isinf(profile[j]))
+                        {
+                            continue;
+                        }
+                        int index = x * width + bz0 + j;
+                        int32_t depth = quantize(profile[j]);
+                        if (format == HeightFormat::Fixed32 && depth < fixedData32[index])
+                        {
+                            fixedData32[index] = depth;
+                            tileChanged = true;
+                        }
+                        else if (format == HeightFormat::Fixed16 && depth - tileBase[tile] < fixedData16[index])
+                        {
+                            fixedData16[index] = int16_t(depth - tileBase[tile]);
+                            tileChanged = true;
+                        }
+                    }
+                }
+            }
+
+            if (tileChanged)
+            {
+                tileDirty[tile] = 1;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
 void WorkPiece::depthToCoords()
 {
     zmapCoords = {};
+    zmapCoords.reserve(size_t(std::max(length - 1, 0)) * std::max(width - 1, 0) * 12);
     for (int x = 0; x < length - 1; x++)
     {
         for (int z = 0; z < width - 1; z++)
@@ -23,6 +425,29 @@ void WorkPiece::depthToCoords()
     }
 }
 
+void WorkPiece::updateCoords(const std::vector<int> &tiles)
+{
+    // depthToCoords中每个网格单元依次存放(x,z)、(x,z+1)、(x+1,z+1)、(x+1,z)四个顶点
+    const int offsets[4][2] = {{0, 0}, {0, 1}, {1, 1}, {1, 0}};
+    for (int tile : tiles)
+    {
+        int x0, x1, z0, z1;
+        tileBounds(tile, x0, x1, z0, z1);
+        // 分块边界上的深度同时被左侧和上方的网格单元引用
+        for (int x = std::max(x0 - 1, 0); x < std::min(x1, length - 1); x++)
+        {
+            for (int z = std::max(z0 - 1, 0); z < std::min(z1, width - 1); z++)
+            {
+                float *cell = &zmapCoords[(size_t(x) * (width - 1) + z) * 12];
+                for (int k = 0; k < 4; k++)
+                {
+                    cell[k * 3 + 1] = getDepth(x + offsets[k][0], z + offsets[k][1]);
+                }
+            }
+        }
+    }
+}
+
 void WorkPiece::generateIndices()
 {
     zmapIndices = {};
@@ -53,4 +478,12 @@ void WorkPiece::generateLineIndices()
         lineIndices.push_back(i + 3);
         lineIndices.push_back(i);
     }
-}
\ No newline at end of file
+}
+
+void WorkPiece::buildMesh(std::vector<float> &coords, std::vector<int> &indices)
+{
+    depthToCoords();
+    generateIndices();
+    coords = zmapCoords;
+    indices = zmapIndices;
+}
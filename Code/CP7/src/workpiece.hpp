@@ -1,38 +1,116 @@
 #pragma once
+#include <cstdint>
 #include <vector>
+#include <glm/glm.hpp>
+#include "cutter.hpp"
+#include "stock.hpp"
 
-class WorkPiece
+// 深度值的存储格式
+enum class HeightFormat
+{
+    // 32位浮点（默认）
+    Float,
+    // 32位定点整数，数值 = fixedData32 * heightUnit
+    Fixed32,
+    // 16位定点整数，数值 = (tileBase + fixedData16) * heightUnit，内存为Float的一半
+    // 同一分块内的高差需小于65535个量化单位，超出部分会被截断
+    Fixed16
+};
+
+class WorkPiece : public Stock
 {
 public:
+    // 分块边长（网格数），用于记录被修改的区域以及16位定点的分块基准值
+    static constexpr int TILE_SIZE = 32;
+
     int length;
     int width;
     float precision;
+    HeightFormat format;
+    // 定点深度的量化单位（毫米），取2的负整数次幂时定点与浮点之间的转换是精确的
+    float heightUnit;
+    int tilesX;
+    int tilesZ;
+    // 按format只有一种深度数组有数据，其余为空
     std::vector<float> depthData;
+    std::vector<int32_t> fixedData32;
+    std::vector<int16_t> fixedData16;
+    std::vector<int32_t> tileBase;
+    std::vector<uint8_t> tileDirty;
     std::vector<float> zmapCoords;
     std::vector<int> zmapIndices;
     std::vector<int> lineIndices;
 
-    WorkPiece(int l, int w, float pres)
-        : length(l), width(w), precision(pres), depthData(w * l, 0.0f) {}
+    WorkPiece(int l, int w, float pres, HeightFormat fmt = HeightFormat::Float, float unit = 1.0f / 1024.0f);
 
-    // 获取某个位置的深度值（单位为毫米）
-    inline float getDepth(int x, int z) const
+    // 网格所在分块的编号
+    inline int tileIndex(int x, int z) const
     {
-        return depthData[x * width + z];
+        return (x / TILE_SIZE) * tilesZ + z / TILE_SIZE;
     }
 
-    // 设置某个位置的深度值
-    inline void setDepth(int x, int z, float depth)
+    // 获取某个位置的深度值（单位为毫米），定点格式在这里转换为浮点
+    inline float getDepth(int x, int z) const
     {
-        depthData[x * width + z] = depth;
+        int index = x * width + z;
+        switch (format)
+        {
+        case HeightFormat::Fixed32:
+            return float(fixedData32[index]) * heightUnit;
+        case HeightFormat::Fixed16:
+            return float(tileBase[tileIndex(x, z)] + fixedData16[index]) * heightUnit;
+        default:
+            return depthData[index];
+        }
     }
 
+    // 设置某个位置的深度值
+    void setDepth(int x, int z, float depth);
+
+    // 把毫米深度量化为定点整数
+    int32_t quantize(float depth) const;
+
+    // 切换深度存储格式，已有深度数据会被转换
+    void setFormat(HeightFormat fmt);
+
+    using Stock::stampCutter;
+
+    // 在刀位toolPosition（网格坐标）处用刀具深度轮廓对工件做最小值更新
+    // x、z取最近的网格点，y保持连续；返回是否有深度值被改变
+    // 定点格式下使用cutter.fixedDepth做整数运算，结果与编译器和线程数无关
+    // 刀轴倾斜或刀具不是球头刀时，改为对每个网格点的竖直射线与刀具几何求交（x、z不取整）
+    bool stampCutter(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis) override;
+
+    // 标记[x0, x1) x [z0, z1)范围覆盖的分块为已修改
+    void markDirty(int x0, int x1, int z0, int z1);
+
+    // 取出自上次调用以来被修改过的分块编号，并清空标记
+    std::vector<int> takeDirtyTiles() override;
+
+    // 分块覆盖的网格范围
+    void tileBounds(int tile, int &x0, int &x1, int &z0, int &z1) const;
+
     // 将深度坐标转换成三维坐标
     void depthToCoords();
 
+    // 只更新给定分块对应的三维坐标高度（需先调用过depthToCoords）
+    void updateCoords(const std::vector<int> &tiles);
+
     // 根据三维坐标生成顶点索引
     void generateIndices();
 
     // 生成网格线条索引
     void generateLineIndices();
-};
\ No newline at end of file
+
+    // 重新生成顶面网格并输出
+    void buildMesh(std::vector<float> &coords, std::vector<int> &indices) override;
+
+private:
+    // 倾斜刀具下包络的逐块缓存
+    std::vector<float> envelope;
+
+    // 16位定点下，使分块能表示不低于minValue的深度
+    void rebaseTile(int tile, int32_t minValue);
+    // 任意刀轴与刀具类型的铣削
+    bool stampTool(const Cutter &cutter, glm::vec3 toolPosition, glm::vec3 toolAxis);
+};